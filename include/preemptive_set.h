@@ -17,14 +17,35 @@ static const char color_table[] = \
 
 typedef uint64_t pset_t;
 
+// The constant time operations are inline functions, defined at the end of
+// this file, so that the compiler can inline them in the loops of the
+// callers. libpset.a holds their external definitions, called when the
+// compiler does not inline them.
+// With PSET_NO_INLINE defined before including this file, every operation
+// is a call to the library.
+#ifndef PSET_NO_INLINE
+#define PSET_INLINE inline
+#else
+#define PSET_INLINE
+#endif
+
+// When the compiler targets processors with the POPCNT instruction, the
+// cardinality is inline too. Otherwise, libpset.a chooses at run time
+// the version the processor can run.
+#if !defined(PSET_NO_INLINE) && defined(__POPCNT__)
+#define PSET_INLINE_POPCNT inline
+#else
+#define PSET_INLINE_POPCNT
+#endif
+
 // Convert a character into a preemptive set
-// Complexity : for n colors O(n)
+// Complexity : for n colors O(1)
 // Parameter : character corresponding to the desired color
 // Return : pset with the corresponding color set to 1 and others to 0
 pset_t char2pset(char);
 
 // Convert a preemptive set into a string of characters
-// Complexity : for n colors O(n)
+// Complexity : for n colors O(k), k being the cardinality of the pset
 // Parameter : the string that will contain the string representation
 //             of the pset. it has to have enough space (MAX_COLOR + 1 max)
 // Parameter : the pset to convert into a string of characters
@@ -36,22 +57,22 @@ void pset2str(char[MAX_COLORS + 1], pset_t);
 //             if the range is greater than MAX_COLOR then it set every
 //             colors to 1
 // Return : the pset with every color of a range set to 1
-pset_t pset_full(unsigned short);
+PSET_INLINE pset_t pset_full(unsigned short);
 
 // Return the empty set
 // Complexity : for n colors O(1)
 // Return : the  pset with every color set to 0
-pset_t pset_empty();
+PSET_INLINE pset_t pset_empty();
 
 // Set a color on a pset
-// Complexity : for n colors O(n)
+// Complexity : for n colors O(1)
 // Parameter : the considered pset to work on
 // Parameter : the character corresponding to the color to set
 // Return : a copy of the pset with the color set to 1
 pset_t pset_set(pset_t, char);
 
 // Reset a color on a pset
-// Complexity : for n colors O(n)
+// Complexity : for n colors O(1)
 // Parameter : the considered pset to work on
 // Parameter : the character corresponding to the color to reset
 // Return : a copy of the pset with the color set to 0
@@ -63,21 +84,21 @@ pset_t pset_discard(pset_t, char);
 // Parameter : the second pset to substract
 // Return : a new pset where all colors of pset1 are set to 1 excepted
 //          those that were also set in pset2
-pset_t pset_substract(pset_t, pset_t);
+PSET_INLINE pset_t pset_substract(pset_t, pset_t);
 
 // Test the equality of two psets
 // Complexity : for n colors O(1)
 // Parameter : the first pset
 // Parameter : the second pset
 // Return : true if the two psets are equals, false in the other case
-bool pset_equals(pset_t, pset_t);
+PSET_INLINE bool pset_equals(pset_t, pset_t);
 
 // Make the absolute complement of a pset
 // Complexity : for n colors O(1)
 // Parameter : the considered pset
 // Return  : a new set where all colors set of the pset are reset
 //           and every colors unset of the pset are set
-pset_t pset_negate(pset_t);
+PSET_INLINE pset_t pset_negate(pset_t);
 
 // Make the intersection of two psets
 // Complexity : for n colors O(1)
@@ -85,7 +106,7 @@ pset_t pset_negate(pset_t);
 // Parameter : the second pset
 // Return : a new pset where a color is set only if it is set in
 //          the first pset AND in the second pset
-pset_t pset_and(pset_t, pset_t);
+PSET_INLINE pset_t pset_and(pset_t, pset_t);
 
 // Make the union of two psets
 // Complexity : for n colors O(1)
@@ -93,7 +114,7 @@ pset_t pset_and(pset_t, pset_t);
 // Parameter : the second pset
 // Return : a new pset where a color is set if it is set in the
 //          first pset OR if it is set in the second pset
-pset_t pset_or(pset_t, pset_t);
+PSET_INLINE pset_t pset_or(pset_t, pset_t);
 
 // Make the strict union of two psets
 // Complexity : for n colors O(1)
@@ -102,40 +123,150 @@ pset_t pset_or(pset_t, pset_t);
 // Return : a new pset where a color is set if it is set in the
 //          first pset OR if it is set in the second pset but not
 //          in both at the same time
-pset_t pset_xor(pset_t, pset_t);
+PSET_INLINE pset_t pset_xor(pset_t, pset_t);
 
 // Test is the first pset is included in the second pset
 // Complexity : for n colors O(1)
 // Parameter : the first pset
 // Parameter : the second pset
 // Return : true if pset1 is totaly included in pset2, false otherwise
-bool pset_is_included(pset_t, pset_t);
+PSET_INLINE bool pset_is_included(pset_t, pset_t);
 
 // Test is the pset has a single element
 // Complexity : for n colors O(1)
 // Parameter : the pset to test
 // Return : true if the pset is a singleton, false in the other case
-bool pset_is_singleton(pset_t);
+PSET_INLINE bool pset_is_singleton(pset_t);
 
 // Compute the number of colors that are in the set
-// Complexity : for n colors O(log n)
+// Complexity : for n colors O(1) with the POPCNT instruction,
+//              O(log n) otherwise
 // Parameter : the considerated pset
 // Return : the cardinality of the pset
-unsigned short pset_cardinality(pset_t);
+PSET_INLINE_POPCNT unsigned short pset_cardinality(pset_t);
 
 // Return the leftmost color from a pset
 // Complexity : for n colors O(1)
 // Parameter : the considered pset
 // Return : a new pset that is the singleton of the leftmost color
 //          if the pset is empty, return a new empty pset
-pset_t pset_leftmost(pset_t);
+PSET_INLINE pset_t pset_leftmost(pset_t);
+
+// Return the index of the leftmost color of a pset
+// Complexity : for n colors O(1)
+// Parameter : the considered pset, which must not be empty
+// Return : the index of the leftmost color, 0 for the first color
+PSET_INLINE int pset_index(pset_t);
 
 // Return the nth leftmost color from a pset
-// Complexity : for n colors O(n)
+// Complexity : for n colors O(1) with the PDEP instruction, O(n) otherwise
 // Parameter : the considered pset
 // Parameter : the number of the color
 // Return : a new pset that is the singleton of the nth leftmost color
 //          if n equals 0, then it returns the considered pset
+//          if the pset has less than n colors, return a new empty pset
 pset_t pset_n_leftmost(pset_t, int);
 
+// Definitions of the inline functions
+#ifndef PSET_NO_INLINE
+inline pset_t
+pset_full(unsigned short color_range)
+{
+    if(color_range > MAX_COLORS)
+        color_range = MAX_COLORS;
+
+    return FULL >> (MAX_COLORS - color_range);
+}
+
+inline pset_t
+pset_empty()
+{
+    return (pset_t) 0;
+}
+
+inline pset_t
+pset_substract(pset_t pset1, pset_t pset2)
+{
+    return pset1 & (~pset2);
+}
+
+inline bool
+pset_equals(pset_t pset1, pset_t pset2)
+{
+    return pset1 == pset2;
+}
+
+inline pset_t
+pset_negate(pset_t pset)
+{
+    return ~pset;
+}
+
+inline pset_t
+pset_and(pset_t pset1, pset_t pset2)
+{
+    return pset1 & pset2;
+}
+
+inline pset_t
+pset_or(pset_t pset1, pset_t pset2)
+{
+    return pset1 | pset2;
+}
+
+inline pset_t
+pset_xor(pset_t pset1, pset_t pset2)
+{
+    return pset1 ^ pset2;
+}
+
+inline bool
+pset_is_included(pset_t pset1, pset_t pset2)
+{
+    // Property of the inclusion
+    return (pset1 & pset2) == pset1;
+}
+
+inline bool
+pset_is_singleton(pset_t pset)
+{
+    // pset & (pset -1) is evaluated at 0 only if
+    // pset is a singleton (or if pset is empty so
+    // we have to test this case too)
+    // As pset - 1 will set every bit at 1 before
+    // the first bit set in pset
+    // If there are more than one bit to 1,
+    // pset - 1 will have some bits in common with pset
+    // and the intersection will not be empty
+    return (pset != 0) && ((pset & (pset - 1)) == 0);
+}
+
+#ifdef __POPCNT__
+inline unsigned short
+pset_cardinality(pset_t pset)
+{
+    return __builtin_popcountll(pset);
+}
+#endif
+
+inline pset_t
+pset_leftmost(pset_t pset)
+{
+    // The two's complement of pset has the same lowest bit set,
+    // and every bit above it flipped (BLSI instruction)
+    return pset & (~pset + 1);
+}
+
+inline int
+pset_index(pset_t pset)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(pset);
+#else
+    // The bits below the leftmost color
+    return pset_cardinality(pset_leftmost(pset) - 1);
+#endif
+}
+#endif
+
 #endif
@@ -0,0 +1,371 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "dlx.h"
+#include "sudoku.h"
+
+// Links of the exact cover matrix of a grid
+// The nodes are indexes in the arrays: node 0 is the root, the nodes 1 to
+// columns are the headers of the columns, and the other ones are the 4
+// nodes of each (cell, color) choice, linked in a circular row
+typedef struct dlx
+{
+    // Size of the grids the arrays are allocated for
+    unsigned short size;
+    int columns;
+    // Number of nodes the arrays of the links are allocated for
+    int nodes;
+    int* left;
+    int* right;
+    int* up;
+    int* down;
+    // Header of the column of each node
+    int* column;
+    // Choice of each node, cell * size + color
+    int* choice;
+    // Number of nodes left in each column
+    int* count;
+    // Whether each column is covered by a cell of the grid
+    bool* covered;
+    // Node of each choice made by the search, by depth
+    int* stack;
+    // Set when the grid holds the first solution found
+    bool solved;
+} dlx_t;
+
+// Allocate the links for the choices left in a grid of size grid_size
+static void dlx_reserve(solver_t*, pset_t*);
+
+// Free the arrays of the links of the nodes
+static void dlx_free_nodes(dlx_t*);
+
+// Build the matrix of the grid, and cover the columns of its singletons
+// Return : false if two singletons share a column, true otherwise
+static bool dlx_build(solver_t*, dlx_t*, pset_t*);
+
+// Append a node at the bottom of a column
+static void dlx_append(dlx_t*, int, int);
+
+// Remove a column from the headers, and the rows of its nodes
+// from the other columns
+static void dlx_cover(dlx_t*, int);
+
+// Undo dlx_cover(), in the reverse order
+static void dlx_uncover(dlx_t*, int);
+
+// Search the choices covering the columns left
+// Parameter : the grid, filled with the first solution found
+// Parameter : the number of choices made
+// Return : return a number of solutions, as grid_solver()
+static int dlx_search(solver_t*, dlx_t*, pset_t*, int);
+
+int
+grid_solver_dlx(solver_t* solver, pset_t* grid)
+{
+    dlx_t* dlx;
+    int heuristics_result = grid_reduce(solver, grid);
+
+    // The heuristics remove most of the choices of the large grids
+    // before the matrix is built
+    if(heuristics_result != CONSISTENT)
+        return (heuristics_result == SOLVED) ? 1 : 0;
+
+    dlx_reserve(solver, grid);
+    dlx = solver->dlx;
+    dlx->solved = false;
+
+    if(!dlx_build(solver, dlx, grid))
+        return 0;
+
+    return dlx_search(solver, dlx, grid, 0);
+}
+
+void
+dlx_free(dlx_t* dlx)
+{
+    if(dlx == NULL)
+        return;
+
+    dlx_free_nodes(dlx);
+    free(dlx->count);
+    free(dlx->covered);
+    free(dlx->stack);
+    free(dlx);
+}
+
+static void
+dlx_reserve(solver_t* solver, pset_t* grid)
+{
+    int size = solver->grid_size;
+    int nodes;
+    dlx_t* dlx = solver->dlx;
+
+    if((dlx == NULL) || (dlx->size != size))
+    {
+        dlx_free(dlx);
+
+        dlx = solver_malloc(solver, sizeof(dlx_t));
+        dlx->size = size;
+        // A column per cell, and per color of each row, column and block
+        dlx->columns = 4 * size * size;
+        dlx->nodes = 0;
+        dlx->left = dlx->right = dlx->up = dlx->down = NULL;
+        dlx->column = dlx->choice = NULL;
+        dlx->count = solver_malloc(solver, (dlx->columns + 1) * sizeof(int));
+        dlx->covered = solver_malloc(solver,
+                (dlx->columns + 1) * sizeof(bool));
+        dlx->stack = solver_malloc(solver, size * size * sizeof(int));
+
+        solver->dlx = dlx;
+    }
+
+    // The root, the headers and 4 nodes for each choice left in the grid,
+    // far fewer than the colors of every cell once the heuristics applied
+    nodes = 1 + dlx->columns;
+    for(int cell = 0 ; cell < grid_cells(solver) ; ++cell)
+        nodes += 4 * pset_cardinality(grid[cell]);
+
+    if(nodes <= dlx->nodes)
+        return;
+
+    // The next grids may need a few more nodes
+    if(nodes < 2 * dlx->nodes)
+        nodes = 2 * dlx->nodes;
+    if(nodes > 1 + dlx->columns + 4 * size * size * size)
+        nodes = 1 + dlx->columns + 4 * size * size * size;
+
+    dlx_free_nodes(dlx);
+
+    dlx->nodes = nodes;
+    dlx->left = solver_malloc(solver, nodes * sizeof(int));
+    dlx->right = solver_malloc(solver, nodes * sizeof(int));
+    dlx->up = solver_malloc(solver, nodes * sizeof(int));
+    dlx->down = solver_malloc(solver, nodes * sizeof(int));
+    dlx->column = solver_malloc(solver, nodes * sizeof(int));
+    dlx->choice = solver_malloc(solver, nodes * sizeof(int));
+}
+
+static void
+dlx_free_nodes(dlx_t* dlx)
+{
+    free(dlx->left);
+    free(dlx->right);
+    free(dlx->up);
+    free(dlx->down);
+    free(dlx->column);
+    free(dlx->choice);
+}
+
+static bool
+dlx_build(solver_t* solver, dlx_t* dlx, pset_t* grid)
+{
+    int size = solver->grid_size;
+    int block_size = (int)sqrt(size);
+    int node = dlx->columns + 1;
+
+    // Headers, linked in a circular row with the root
+    for(int i = 0 ; i <= dlx->columns ; ++i)
+    {
+        dlx->left[i] = (i == 0) ? dlx->columns : i - 1;
+        dlx->right[i] = (i == dlx->columns) ? 0 : i + 1;
+        dlx->up[i] = dlx->down[i] = i;
+        dlx->column[i] = i;
+        dlx->count[i] = 0;
+        dlx->covered[i] = false;
+    }
+
+    for(int cell = 0 ; cell < grid_cells(solver) ; ++cell)
+    {
+        int x = cell / size;
+        int y = cell % size;
+        int block = (x / block_size) * block_size + (y / block_size);
+
+        for(int color = 0 ; color < size ; ++color)
+        {
+            if(!pset_is_included(((pset_t) 1) << color, grid[cell]))
+                continue;
+
+            // Columns of the cell, then of the color in its row,
+            // its column and its block
+            int columns[4] = {
+                1 + cell,
+                1 + size * size + x * size + color,
+                1 + 2 * size * size + y * size + color,
+                1 + 3 * size * size + block * size + color};
+
+            for(int k = 0 ; k < 4 ; ++k)
+            {
+                dlx->left[node + k] = node + (k + 3) % 4;
+                dlx->right[node + k] = node + (k + 1) % 4;
+                dlx->choice[node + k] = cell * size + color;
+                dlx_append(dlx, columns[k], node + k);
+            }
+
+            node += 4;
+        }
+    }
+
+    // The singletons are choices already made: their columns are covered
+    // before the search, which removes their color from their peers
+    node = dlx->columns + 1;
+    for(int cell = 0 ; cell < grid_cells(solver) ; ++cell)
+    {
+        int cardinality = pset_cardinality(grid[cell]);
+
+        if(cardinality == 0)
+            return false;
+
+        if(cardinality == 1)
+        {
+            int row = node;
+
+            do
+            {
+                if(dlx->covered[dlx->column[row]])
+                    return false;
+
+                dlx->covered[dlx->column[row]] = true;
+                dlx_cover(dlx, dlx->column[row]);
+                row = dlx->right[row];
+            }
+            while(row != node);
+        }
+
+        node += 4 * cardinality;
+    }
+
+    return true;
+}
+
+static void
+dlx_append(dlx_t* dlx, int column, int node)
+{
+    dlx->column[node] = column;
+    dlx->up[node] = dlx->up[column];
+    dlx->down[node] = column;
+    dlx->down[dlx->up[column]] = node;
+    dlx->up[column] = node;
+    ++dlx->count[column];
+}
+
+static void
+dlx_cover(dlx_t* dlx, int column)
+{
+    dlx->right[dlx->left[column]] = dlx->right[column];
+    dlx->left[dlx->right[column]] = dlx->left[column];
+
+    for(int row = dlx->down[column] ; row != column ; row = dlx->down[row])
+        for(int node = dlx->right[row] ; node != row ; node = dlx->right[node])
+        {
+            dlx->down[dlx->up[node]] = dlx->down[node];
+            dlx->up[dlx->down[node]] = dlx->up[node];
+            --dlx->count[dlx->column[node]];
+        }
+}
+
+static void
+dlx_uncover(dlx_t* dlx, int column)
+{
+    for(int row = dlx->up[column] ; row != column ; row = dlx->up[row])
+        for(int node = dlx->left[row] ; node != row ; node = dlx->left[node])
+        {
+            ++dlx->count[dlx->column[node]];
+            dlx->down[dlx->up[node]] = node;
+            dlx->up[dlx->down[node]] = node;
+        }
+
+    dlx->right[dlx->left[column]] = column;
+    dlx->left[dlx->right[column]] = column;
+}
+
+static int
+dlx_search(solver_t* solver, dlx_t* dlx, pset_t* grid, int depth)
+{
+    // Current number of solutions
+    int result = 0;
+    int column = 0;
+
+    ++solver->stats.nodes;
+
+    // Every column is covered: the choices made are a solution
+    if(dlx->right[0] == 0)
+    {
+        // The grid is only written once, the strict mode goes on
+        // searching an other solution
+        if(!dlx->solved)
+        {
+            for(int i = 0 ; i < depth ; ++i)
+            {
+                int choice = dlx->choice[dlx->stack[i]];
+
+                grid[choice / solver->grid_size] =
+                    ((pset_t) 1) << (choice % solver->grid_size);
+            }
+
+            dlx->solved = true;
+        }
+
+        return 1;
+    }
+
+    // Choose the column with the fewest choices left, the colors of the
+    // blocks, rows and columns before the cells, which makes a smaller
+    // search, and stop at a column which leaves no choice
+    for(int i = dlx->left[0] ; i != 0 ; i = dlx->left[i])
+        if((column == 0) || (dlx->count[i] < dlx->count[column]))
+        {
+            column = i;
+            if(dlx->count[column] <= 1)
+                break;
+        }
+
+    if(dlx->count[column] == 0)
+        return 0;
+
+    dlx_cover(dlx, column);
+
+    for(int row = dlx->down[column] ; row != column ; row = dlx->down[row])
+    {
+        int number_of_solutions;
+
+        if(solver->verbose)
+        {
+            int choice = dlx->choice[row];
+            char str_color[MAX_COLORS + 1];
+
+            pset2str(str_color, ((pset_t) 1) << (choice % solver->grid_size));
+            fprintf(solver->output_stream,
+                    "Next choice at grid[%d][%d] is '%s'.\n",
+                    (choice / solver->grid_size) / solver->grid_size,
+                    (choice / solver->grid_size) % solver->grid_size,
+                    str_color);
+        }
+
+        dlx->stack[depth] = row;
+
+        for(int node = dlx->right[row] ; node != row ; node = dlx->right[node])
+            dlx_cover(dlx, dlx->column[node]);
+
+        number_of_solutions = dlx_search(solver, dlx, grid, depth + 1);
+
+        for(int node = dlx->left[row] ; node != row ; node = dlx->left[node])
+            dlx_uncover(dlx, dlx->column[node]);
+
+        if(number_of_solutions >= 1)
+        {
+            result += number_of_solutions;
+
+            // If strict mode is set and still not 2 solutions, then continue
+            if(!solver->strict || (result > 1))
+                break;
+        }
+        else if(solver->verbose)
+            fprintf(solver->output_stream, "Bad choice.\n");
+    }
+
+    dlx_uncover(dlx, column);
+
+    return result;
+}
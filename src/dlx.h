@@ -0,0 +1,22 @@
+/* DLX_H */
+#ifndef DLX_H
+#define DLX_H
+
+#include <preemptive_set.h>
+
+#include "solver.h"
+
+// Search for a solution with the dancing links of Knuth's Algorithm X
+// The grid is an exact cover problem: each cell, and each color of each
+// row, column and block, must be covered by exactly one (cell, color)
+// choice among the colors left in the cells by the heuristics.
+// The strict and verbose modes are handled as grid_solver() does, but the
+// search trace only tells the choices made.
+// Parameter : the grid to solve, which holds the first solution found
+// Return : return a number of solutions, as grid_solver()
+int grid_solver_dlx(solver_t*, pset_t*);
+
+// Free the links of a solver
+void dlx_free(struct dlx*);
+
+#endif
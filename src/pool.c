@@ -0,0 +1,348 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <unistd.h>
+
+#include "pool.h"
+#include "sudoku.h"
+
+typedef struct
+{
+    pool_task_t func;
+    void* arg;
+} task_t;
+
+// Deque of tasks of a worker
+// The owner pushes and pops at the tail, thieves take from the head
+typedef struct
+{
+    pthread_mutex_t lock;
+    task_t* tasks;
+    // Capacity of the ring buffer, always a power of 2
+    size_t capacity;
+    size_t head, tail;
+} deque_t;
+
+typedef struct
+{
+    pool_t* pool;
+    int index;
+    pthread_t thread;
+    deque_t deque;
+} worker_t;
+
+struct pool
+{
+    int workers_number;
+    worker_t* workers;
+
+    // Number of tasks waiting in a deque
+    int queued;
+    // Number of tasks submitted and not finished yet
+    int pending;
+    // Number of workers sleeping while there is no task
+    int sleepers;
+    bool stop;
+    // Worker receiving the next task submitted from outside the pool
+    unsigned int next_worker;
+
+    pthread_mutex_t lock;
+    // Signaled when a task is submitted
+    pthread_cond_t work;
+    // Signaled when there is no pending task anymore
+    pthread_cond_t idle;
+};
+
+static void deque_init(deque_t*);
+
+static void deque_destroy(deque_t*);
+
+static void deque_push(deque_t*, task_t);
+
+// Take the newest task of the deque
+// Return : false if the deque is empty
+static bool deque_pop(deque_t*, task_t*);
+
+// Take the oldest task of the deque
+// Return : false if the deque is empty
+static bool deque_steal(deque_t*, task_t*);
+
+static void* pool_worker(void*);
+
+// Find the next task to run, sleeping while there is none
+// Return : false if the pool is stopping
+static bool pool_next_task(worker_t*, task_t*);
+
+// Worker of the calling thread, NULL outside of the workers
+static pthread_key_t worker_key;
+static pthread_once_t worker_key_once = PTHREAD_ONCE_INIT;
+
+static void
+worker_key_create(void)
+{
+    pthread_key_create(&worker_key, NULL);
+}
+
+pool_t*
+pool_create(int workers_number)
+{
+    pool_t* pool;
+
+    if(workers_number < 1)
+        workers_number = 1;
+
+    pthread_once(&worker_key_once, worker_key_create);
+
+    pool = calloc(1, sizeof(pool_t));
+    if(pool == NULL)
+        grid_error("out of memory !");
+
+    pool->workers = calloc(workers_number, sizeof(worker_t));
+    if(pool->workers == NULL)
+        grid_error("out of memory !");
+
+    pool->workers_number = workers_number;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+
+    for(int i = 0 ; i < workers_number ; ++i)
+    {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        deque_init(&pool->workers[i].deque);
+    }
+
+    for(int i = 0 ; i < workers_number ; ++i)
+        if(pthread_create(&pool->workers[i].thread,
+                    NULL,
+                    pool_worker,
+                    &pool->workers[i]) != 0)
+            grid_error("cannot create a thread");
+
+    return pool;
+}
+
+void
+pool_submit(pool_t* pool, pool_task_t func, void* arg)
+{
+    task_t task = {func, arg};
+    worker_t* worker = pthread_getspecific(worker_key);
+
+    // Tasks from outside of the pool are spread over the workers
+    if((worker == NULL) || (worker->pool != pool))
+    {
+        unsigned int next = __atomic_fetch_add(&pool->next_worker,
+                1,
+                __ATOMIC_RELAXED);
+
+        worker = &pool->workers[next % pool->workers_number];
+    }
+
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+    deque_push(&worker->deque, task);
+    __atomic_add_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+
+    // Wake up a sleeping worker, the lock ensures that a worker
+    // about to sleep has either seen the task or is already waiting
+    if(__atomic_load_n(&pool->sleepers, __ATOMIC_SEQ_CST) > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->work);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+void
+pool_wait(pool_t* pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    while(__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) > 0)
+        pthread_cond_wait(&pool->idle, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void
+pool_destroy(pool_t* pool)
+{
+    pool_wait(pool);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    // A worker can steal from the others until it stops
+    for(int i = 0 ; i < pool->workers_number ; ++i)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    for(int i = 0 ; i < pool->workers_number ; ++i)
+        deque_destroy(&pool->workers[i].deque);
+
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+
+    free(pool->workers);
+    free(pool);
+}
+
+int
+pool_workers(pool_t* pool)
+{
+    return pool->workers_number;
+}
+
+int
+pool_cpu_count(void)
+{
+    long result = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (result < 1) ? 1 : (int)result;
+}
+
+static void
+deque_init(deque_t* deque)
+{
+    pthread_mutex_init(&deque->lock, NULL);
+
+    deque->capacity = 64;
+    deque->head = deque->tail = 0;
+    deque->tasks = malloc(deque->capacity * sizeof(task_t));
+    if(deque->tasks == NULL)
+        grid_error("out of memory !");
+}
+
+static void
+deque_destroy(deque_t* deque)
+{
+    pthread_mutex_destroy(&deque->lock);
+    free(deque->tasks);
+}
+
+static void
+deque_push(deque_t* deque, task_t task)
+{
+    pthread_mutex_lock(&deque->lock);
+
+    // Double the ring buffer when it is full
+    if((deque->tail - deque->head) == deque->capacity)
+    {
+        task_t* tasks = malloc(2 * deque->capacity * sizeof(task_t));
+        if(tasks == NULL)
+            grid_error("out of memory !");
+
+        for(size_t i = deque->head ; i != deque->tail ; ++i)
+            tasks[i & (2 * deque->capacity - 1)] =
+                deque->tasks[i & (deque->capacity - 1)];
+
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->capacity *= 2;
+    }
+
+    deque->tasks[deque->tail & (deque->capacity - 1)] = task;
+    ++deque->tail;
+
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool
+deque_pop(deque_t* deque, task_t* task)
+{
+    bool result = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if(deque->tail != deque->head)
+    {
+        --deque->tail;
+        *task = deque->tasks[deque->tail & (deque->capacity - 1)];
+        result = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return result;
+}
+
+static bool
+deque_steal(deque_t* deque, task_t* task)
+{
+    bool result = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if(deque->tail != deque->head)
+    {
+        *task = deque->tasks[deque->head & (deque->capacity - 1)];
+        ++deque->head;
+        result = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return result;
+}
+
+static void*
+pool_worker(void* arg)
+{
+    worker_t* worker = arg;
+    pool_t* pool = worker->pool;
+    task_t task;
+
+    pthread_setspecific(worker_key, worker);
+
+    while(pool_next_task(worker, &task))
+    {
+        task.func(task.arg, worker->index);
+
+        if(__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST) == 0)
+        {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_broadcast(&pool->idle);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+
+    return NULL;
+}
+
+static bool
+pool_next_task(worker_t* worker, task_t* task)
+{
+    pool_t* pool = worker->pool;
+
+    while(true)
+    {
+        bool found = deque_pop(&worker->deque, task);
+
+        // Steal from the other workers, starting with the next one
+        for(int i = 1 ; (i < pool->workers_number) && !found ; ++i)
+        {
+            int victim = (worker->index + i) % pool->workers_number;
+
+            found = deque_steal(&pool->workers[victim].deque, task);
+        }
+
+        if(found)
+        {
+            __atomic_sub_fetch(&pool->queued, 1, __ATOMIC_SEQ_CST);
+            return true;
+        }
+
+        // Sleep until a task is submitted
+        bool stop;
+
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        while((__atomic_load_n(&pool->queued, __ATOMIC_SEQ_CST) == 0)
+                && !pool->stop)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        __atomic_sub_fetch(&pool->sleepers, 1, __ATOMIC_SEQ_CST);
+        stop = pool->stop && (__atomic_load_n(&pool->queued,
+                    __ATOMIC_SEQ_CST) == 0);
+        pthread_mutex_unlock(&pool->lock);
+
+        if(stop)
+            return false;
+    }
+}
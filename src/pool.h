@@ -0,0 +1,39 @@
+/* POOL_H */
+#ifndef POOL_H
+#define POOL_H
+
+typedef struct pool pool_t;
+
+// Function run by a task
+// Parameter : the argument given when the task was submitted
+// Parameter : the index of the worker running the task (0 to workers - 1)
+typedef void (*pool_task_t)(void*, int);
+
+// Start a pool of worker threads
+// Each worker owns a deque of tasks: it runs its own tasks, newest first,
+// and when it has no task left it steals the oldest tasks of the others
+// Parameter : the number of workers
+// Return : the new pool
+pool_t* pool_create(int);
+
+// Submit a task to the pool
+// A task submitted by a worker goes to its own deque, tasks submitted
+// by other threads are spread over the workers
+// Parameter : the pool
+// Parameter : the function of the task
+// Parameter : the argument given to the function
+void pool_submit(pool_t*, pool_task_t, void*);
+
+// Wait until every task submitted to the pool has been run
+void pool_wait(pool_t*);
+
+// Wait for every task, then stop the workers and free the pool
+void pool_destroy(pool_t*);
+
+// Return : the number of workers of the pool
+int pool_workers(pool_t*);
+
+// Return : the number of processors available
+int pool_cpu_count(void);
+
+#endif
@@ -2,65 +2,124 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-pset_t
-char2pset(char c)
-{
-    pset_t result = 0;
-    int color_index = -1;
+// On x86, the instructions of the processor are used when it has them
+// The choice is made at the first call, so that the same library runs
+// on processors without them
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PSET_DISPATCH
+#include <immintrin.h>
+#endif
 
-    for(int i = 0 ; i < MAX_COLORS ; ++i)
-    {
-        if(color_table[i] == c)
-        {
-            color_index = i;
-            break;
-        }
-    }
+// pset_cardinality() is inline in the header when the compiler targets
+// processors with the POPCNT instruction, there is no version to choose
+#if defined(__POPCNT__)
+#define PSET_INLINE_CARDINALITY
+#endif
 
-    if(color_index != -1)
-    {
-        result = 1;
-        result <<= color_index;
-    }
+// Portable versions of pset_cardinality() and pset_n_leftmost()
+#ifndef PSET_INLINE_CARDINALITY
+static unsigned short cardinality_generic(pset_t);
+#endif
+
+static pset_t n_leftmost_generic(pset_t, int);
+
+#ifdef PSET_DISPATCH
+// Versions using the POPCNT and PDEP instructions
+#ifndef PSET_INLINE_CARDINALITY
+static unsigned short cardinality_popcnt(pset_t);
+#endif
+
+static pset_t n_leftmost_pdep(pset_t, int);
+
+// Choose the version of a function the processor can run, at its first call
+#ifndef PSET_INLINE_CARDINALITY
+static unsigned short cardinality_dispatch(pset_t);
+
+static unsigned short (*cardinality_impl)(pset_t) = cardinality_dispatch;
+#endif
+
+static pset_t n_leftmost_dispatch(pset_t, int);
+
+static pset_t (*n_leftmost_impl)(pset_t, int) = n_leftmost_dispatch;
+#endif
+
+// External definitions of the inline functions of the header, for the code
+// which does not inline them
+extern pset_t pset_full(unsigned short);
+
+extern pset_t pset_empty();
+
+extern pset_t pset_substract(pset_t, pset_t);
+
+extern bool pset_equals(pset_t, pset_t);
+
+extern pset_t pset_negate(pset_t);
+
+extern pset_t pset_and(pset_t, pset_t);
+
+extern pset_t pset_or(pset_t, pset_t);
 
-    return result;
+extern pset_t pset_xor(pset_t, pset_t);
+
+extern bool pset_is_included(pset_t, pset_t);
+
+extern bool pset_is_singleton(pset_t);
+
+extern pset_t pset_leftmost(pset_t);
+
+extern int pset_index(pset_t);
+
+#ifdef PSET_INLINE_CARDINALITY
+extern unsigned short pset_cardinality(pset_t);
+#endif
+
+// Pset of each character, empty for the characters which are not colors
+// The colors are the ones of color_table, in the same order
+#define COLOR(c, i) [(unsigned char) (c)] = ((pset_t) 1) << (i)
+
+static const pset_t char_table[256] = {
+    COLOR('1', 0), COLOR('2', 1), COLOR('3', 2), COLOR('4', 3),
+    COLOR('5', 4), COLOR('6', 5), COLOR('7', 6), COLOR('8', 7),
+    COLOR('9', 8), COLOR('A', 9), COLOR('B', 10), COLOR('C', 11),
+    COLOR('D', 12), COLOR('E', 13), COLOR('F', 14), COLOR('G', 15),
+    COLOR('H', 16), COLOR('I', 17), COLOR('J', 18), COLOR('K', 19),
+    COLOR('L', 20), COLOR('M', 21), COLOR('N', 22), COLOR('O', 23),
+    COLOR('P', 24), COLOR('Q', 25), COLOR('R', 26), COLOR('S', 27),
+    COLOR('T', 28), COLOR('U', 29), COLOR('V', 30), COLOR('W', 31),
+    COLOR('X', 32), COLOR('Y', 33), COLOR('Z', 34), COLOR('a', 35),
+    COLOR('b', 36), COLOR('c', 37), COLOR('d', 38), COLOR('e', 39),
+    COLOR('f', 40), COLOR('g', 41), COLOR('h', 42), COLOR('i', 43),
+    COLOR('j', 44), COLOR('k', 45), COLOR('l', 46), COLOR('m', 47),
+    COLOR('n', 48), COLOR('o', 49), COLOR('p', 50), COLOR('q', 51),
+    COLOR('r', 52), COLOR('s', 53), COLOR('t', 54), COLOR('u', 55),
+    COLOR('v', 56), COLOR('w', 57), COLOR('x', 58), COLOR('y', 59),
+    COLOR('z', 60), COLOR('@', 61), COLOR('&', 62), COLOR('*', 63)};
+
+#undef COLOR
+
+pset_t
+char2pset(char c)
+{
+    return char_table[(unsigned char) c];
 }
 
 void
 pset2str(char string[MAX_COLORS + 1], pset_t pset)
 {
-    pset_t tmp = pset;
     int card = 0;
 
-    for(int i = 0 ; i < MAX_COLORS ; ++i)
+    // Only the colors of the pset are visited, from the leftmost one
+    while(pset != 0)
     {
-        if((tmp % 2) == 1)
-        {
-            string[card] = color_table[i];
-            ++card;
-        }
+        string[card] = color_table[pset_index(pset)];
+        ++card;
 
-        tmp >>= 1;
+        pset &= pset - 1;
     }
 
     string[card] = '\0';
 }
 
-pset_t
-pset_full(unsigned short color_range)
-{
-    if(color_range > MAX_COLORS)
-        color_range = MAX_COLORS;
-
-    return FULL >> (MAX_COLORS - color_range);
-}
-
-pset_t
-pset_empty()
-{
-    return (pset_t) 0;
-}
-
 pset_t
 pset_set(pset_t pset, char c)
 {
@@ -73,65 +132,38 @@ pset_discard(pset_t pset, char c)
     return pset & (~char2pset(c));
 }
 
-pset_t
-pset_substract(pset_t pset1, pset_t pset2)
-{
-    return pset1 & (~pset2);
-}
-
-bool
-pset_equals(pset_t pset1, pset_t pset2)
-{
-    return pset1 == pset2;
-}
-
-pset_t
-pset_negate(pset_t pset)
-{
-    return ~pset;
-}
-
-pset_t
-pset_and(pset_t pset1, pset_t pset2)
+#ifndef PSET_INLINE_CARDINALITY
+unsigned short
+pset_cardinality(pset_t pset)
 {
-    return pset1 & pset2;
+#ifdef PSET_DISPATCH
+    return __atomic_load_n(&cardinality_impl, __ATOMIC_RELAXED)(pset);
+#else
+    return cardinality_generic(pset);
+#endif
 }
+#endif
 
 pset_t
-pset_or(pset_t pset1, pset_t pset2)
+pset_n_leftmost(pset_t pset, int n)
 {
-    return pset1 | pset2;
-}
+    if(n <= 0)
+        return pset;
 
-pset_t
-pset_xor(pset_t pset1, pset_t pset2)
-{
-    return pset1 ^ pset2;
-}
+    // There is no nth color
+    if(n > MAX_COLORS)
+        return pset_empty();
 
-bool
-pset_is_included(pset_t pset1, pset_t pset2)
-{
-    // Property of the inclusion
-    return (pset1 & pset2) == pset1;
+#ifdef PSET_DISPATCH
+    return __atomic_load_n(&n_leftmost_impl, __ATOMIC_RELAXED)(pset, n);
+#else
+    return n_leftmost_generic(pset, n);
+#endif
 }
 
-bool
-pset_is_singleton(pset_t pset)
-{
-    // pset & (pset -1) is evaluated at 0 only if
-    // pset is a singleton (or if pset is empty so
-    // we have to test this case too)
-    // As pset - 1 will set every bit at 1 before
-    // the first bit set in pset
-    // If there are more than one bit to 1,
-    // pset - 1 will have some bits in common with pset
-    // and the intersection will not be empty
-    return (pset != 0) && ((pset & (pset - 1)) == 0);
-}
-
-unsigned short
-pset_cardinality(pset_t pset)
+#ifndef PSET_INLINE_CARDINALITY
+static unsigned short
+cardinality_generic(pset_t pset)
 {
     // Compute the Hamming weight of the preemptive set
     // The algorithm used is as it is defined on the page
@@ -157,31 +189,64 @@ pset_cardinality(pset_t pset)
     // pset + (pset<<8) + (pset<<16) + (pset<<24) + ...
     return (pset * h01) >> 56;
 }
+#endif
 
-pset_t
-pset_leftmost(pset_t pset)
+static pset_t
+n_leftmost_generic(pset_t pset, int n)
 {
-    pset_t result;
+    // Remove the n - 1 leftmost colors
+    for(int i = 0 ; (i < (n - 1)) && (pset != 0) ; ++i)
+        pset &= pset - 1;
 
-    result = pset - 1;
-    result = pset & result;
-    result = pset ^ result;
+    return pset_leftmost(pset);
+}
 
-    return result;
+#ifdef PSET_DISPATCH
+#ifndef PSET_INLINE_CARDINALITY
+__attribute__((target("popcnt")))
+static unsigned short
+cardinality_popcnt(pset_t pset)
+{
+    return __builtin_popcountll(pset);
 }
+#endif
 
-pset_t
-pset_n_leftmost(pset_t pset, int n)
+__attribute__((target("bmi2")))
+static pset_t
+n_leftmost_pdep(pset_t pset, int n)
+{
+    // Deposit the nth bit of a mask on the nth color of the pset,
+    // it is lost if the pset has less than n colors
+    return _pdep_u64(((pset_t) 1) << (n - 1), pset);
+}
+
+#ifndef PSET_INLINE_CARDINALITY
+static unsigned short
+cardinality_dispatch(pset_t pset)
 {
-    pset_t result = pset;
+    unsigned short (*impl)(pset_t) = cardinality_generic;
 
-    if(n > 0)
-    {
-        for(int i = 0 ; i < (n - 1) ; ++i)
-            result = pset_substract(result, pset_leftmost(result));
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("popcnt"))
+        impl = cardinality_popcnt;
 
-        result = pset_leftmost(result);
-    }
+    __atomic_store_n(&cardinality_impl, impl, __ATOMIC_RELAXED);
+
+    return impl(pset);
+}
+#endif
+
+static pset_t
+n_leftmost_dispatch(pset_t pset, int n)
+{
+    pset_t (*impl)(pset_t, int) = n_leftmost_generic;
+
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("bmi2"))
+        impl = n_leftmost_pdep;
+
+    __atomic_store_n(&n_leftmost_impl, impl, __ATOMIC_RELAXED);
 
-    return result;
+    return impl(pset, n);
 }
+#endif
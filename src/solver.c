@@ -0,0 +1,1473 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dlx.h"
+#include "solver.h"
+#include "sudoku.h"
+
+// Shared state of a parallel search
+typedef struct search
+{
+    solver_t* solvers;
+    pool_t* pool;
+    // Number of solutions after which the search is cancelled
+    int target;
+    // Number of solutions found so far
+    int solutions;
+    // Branch holding the first solution found
+    struct branch* solution;
+    // Branch of the grid to solve
+    struct branch* root;
+    pthread_mutex_t lock;
+} search_t;
+
+// Branch of the backtracking, solved as a task of the pool
+// The branches are reused from a search to another, through the list
+// of branches of the solver of the worker that ran them last
+typedef struct branch
+{
+    search_t* search;
+    // Grid of the branch, which is the cells of the branch
+    // except for the root, which solves the grid given to the search
+    pset_t* grid;
+    int depth;
+    // Size of the cells of the branch
+    unsigned short grid_size;
+    // Next branch of the list of branches ready to be reused
+    struct branch* next;
+    pset_t cells[];
+} branch_t;
+
+// Solve a branch, run by a worker of the pool
+static void branch_run(void*, int);
+
+// Apply the heuristics to the grid of a branch and submit a new
+// branch for each color of the cell choosen for the backtracking
+// Return : 1 if the heuristics solved the grid, 0 otherwise
+static int branch_split(solver_t*, branch_t*);
+
+// Return : true if enough solutions have been found by the search
+static bool search_stopped(search_t*);
+
+// Take a branch from the list of the solver, allocating one if it is empty
+static branch_t* branch_alloc(solver_t*);
+
+// Give back a branch to the list of the solver
+static void branch_release(solver_t*, branch_t*);
+
+// Make sure the buffers of the solver fit the current grid size
+static void solver_reserve(solver_t*);
+
+// Return : the print buffer of the solver, holding at least the given size
+static char* print_reserve(solver_t*, size_t);
+
+// Reallocate memory, counting the allocations in the statistics
+static void* solver_realloc(solver_t*, void*, size_t);
+
+// Reset the state of the search for a new grid
+// Return : false if the grid is already unconsistent
+static bool search_init(solver_t*, pset_t*);
+
+// Search for a solution with the heuristics engine, as grid_solver()
+static int grid_solver_heuristics(solver_t*, pset_t*);
+
+// Recursive search of grid_solver_heuristics()
+static int grid_search(solver_t*, pset_t*);
+
+// Fill the digit planes of the subgrids from the cells of a grid
+static void planes_build(solver_t*, pset_t*);
+
+// Add a cell to the bucket of the cells of a given cardinality
+static void bucket_insert(solver_t*, int, int);
+
+// Remove a cell from the bucket of the cells of a given cardinality
+static void bucket_remove(solver_t*, int, int);
+
+// Queue a subgrid for the heuristics, if it is not queued yet
+static void subgrid_enqueue(solver_t*, int);
+
+// Queue every subgrid of the grid
+static void queue_fill(solver_t*);
+
+// Empty the queue of the subgrids
+static void queue_clear(solver_t*);
+
+// Build the tables of the subgrids and of the peers of the cells
+static void subgrids_build(solver_t*);
+
+#ifdef DEBUG
+static bool subgrid_print(solver_t*, pset_t*, const int*);
+#endif
+
+// Apply the heuristics of the pipeline to the queued subgrids until the
+// queue is empty, then the ones of its second stage to the stale subgrids,
+// and so on until no subgrid is queued
+// Return : SOLVED if the grid has been solved
+//          CONSISTENT if it has not been solved but still consistent
+//          INCONSISTENT if not solved and unconsistent
+static int grid_heuristics(solver_t*, pset_t*);
+
+// Apply heuristics of the pipeline to the subgrid, counting their calls
+// and the colors they remove
+// The subgrids of the cells they modify are queued again
+// Parameter : the pipeline
+// Parameter : the first and the last (excluded) heuristics applied
+static void subgrid_heuristics(solver_t*,
+        pset_t*,
+        const int*,
+        const pipeline_t*,
+        int,
+        int);
+
+// Return : the pipeline of the heuristics of the solver, the default one of
+//          the grid size if none has been given
+static const pipeline_t* pipeline_select(solver_t*);
+
+// Return : a cell with the fewest colors among the cells which are not
+//          singletons, -1 if there is none
+static int grid_choice(solver_t*);
+
+static bool grid_consistency(solver_t*, pset_t*);
+
+// Return : the number of cells which are not singletons
+static int grid_unsolved(solver_t*, pset_t*);
+
+// The GNU vector extensions let cross_hatching() and lone_number() work
+// on several cells at once, compiled to the SIMD instructions of the target
+#if defined(__GNUC__) && !defined(SOLVER_NO_VECTOR)
+#define SOLVER_VECTOR
+
+// Number of psets in a vector, as wide as the vector registers of the
+// target (build with -march=native to use the widest ones)
+#if defined(__AVX512F__)
+#define VECTOR_LANES 8
+#elif defined(__AVX2__)
+#define VECTOR_LANES 4
+#else
+#define VECTOR_LANES 2
+#endif
+
+// Smallest size of the grids whose kernels are vectorized: the subgrids
+// of the smaller ones fill too few vectors to pay for moving their cells
+// in and out of the lanes
+#define VECTOR_MIN_SIZE 16
+
+typedef pset_t pset_vector_t
+    __attribute__((vector_size(VECTOR_LANES * sizeof(pset_t))));
+
+// Return : a vector holding a pset in each lane
+static inline pset_vector_t vector_broadcast(pset_t);
+
+// Return : a vector of masks, full in the lanes holding a singleton
+static inline pset_vector_t vector_singletons(pset_vector_t);
+
+// Return : the union of the lanes of a vector
+static inline pset_t vector_or_lanes(pset_vector_t);
+#endif
+
+// Return : the slot of a pset in a hash table of 2^bits slots
+static inline int pset_hash(pset_t, int);
+
+// Return : true if a pset has at most a few colors, which is tested without
+//          counting them
+static inline bool pset_at_most(pset_t, int);
+
+// Heuristics and checks of the subgrids, for a grid size
+typedef struct kernels
+{
+    // Heuristics, indexed by heuristic_t
+    bool (*heuristics[HEURISTICS_NUMBER])(solver_t*, pset_t*, const int*);
+    bool (*subgrid_consistency)(solver_t*, pset_t*, const int*);
+    void (*cell_assign)(solver_t*, pset_t*, int, pset_t);
+    void (*trail_undo)(solver_t*, pset_t*, int);
+    // Size of an entry of the trail
+    size_t trail_entry_size;
+} kernels_t;
+
+// Return : the kernels specialized for a grid size
+static const kernels_t* kernels_select(int);
+
+// The kernels of every valid size, and the size of its blocks
+#define SIZE 1
+#define BLOCK_SIZE 1
+#include "solver_kernels.h"
+#define SIZE 4
+#define BLOCK_SIZE 2
+#include "solver_kernels.h"
+#define SIZE 9
+#define BLOCK_SIZE 3
+#include "solver_kernels.h"
+#define SIZE 16
+#define BLOCK_SIZE 4
+#include "solver_kernels.h"
+#define SIZE 25
+#define BLOCK_SIZE 5
+#include "solver_kernels.h"
+#define SIZE 36
+#define BLOCK_SIZE 6
+#include "solver_kernels.h"
+#define SIZE 49
+#define BLOCK_SIZE 7
+#include "solver_kernels.h"
+#define SIZE 64
+#define BLOCK_SIZE 8
+#include "solver_kernels.h"
+
+pset_t*
+grid_alloc(solver_t* solver)
+{
+    pset_t* result;
+
+    // The cells are stored row after row in a single block
+    result = solver_malloc(solver, grid_cells(solver) * sizeof(pset_t));
+    memset(result, 0, grid_cells(solver) * sizeof(pset_t));
+
+    return result;
+}
+
+void
+grid_free(solver_t* solver, pset_t* grid)
+{
+    (void)solver;
+
+    free(grid);
+}
+
+pset_t*
+grid_copy(solver_t* solver, pset_t* grid)
+{
+    pset_t* result;
+
+    result = grid_alloc(solver);
+    memcpy(result, grid, grid_cells(solver) * sizeof(pset_t));
+
+    return result;
+}
+
+int
+grid_cells(solver_t* solver)
+{
+    return solver->grid_size * solver->grid_size;
+}
+
+pset_t*
+grid_generate(solver_t* solver)
+{
+    pset_t* result = grid_alloc(solver);
+    int remove_limit, percent;
+    bool still_choices = true;
+    // Bidimentional array to check if a cell can be removed
+    bool checked_cells[solver->grid_size][solver->grid_size];
+    int removed_cells = 0;
+
+    // Fill up the grid with full pset
+    for(int i = 0 ; i < grid_cells(solver) ; ++i)
+        result[i] = pset_full(solver->grid_size);
+
+    for(int i = 0 ; i < solver->grid_size ; ++i)
+        for(int j = 0 ; j < solver->grid_size ; ++j)
+            checked_cells[i][j] = false;
+
+    // Slove the grid, as the backtracking use random choices if
+    // it is in generate mode, it generates a randomly grid but
+    // consistent and solved (only the heuristics engine makes random
+    // choices, whatever the engine checking the unicity of the grid)
+    grid_solver_heuristics(solver, result);
+
+    // Compute the percentage of cells to remove
+    if(solver->grid_size == 1)
+        percent = 100;
+    else
+    {
+        if(solver->grid_size <= 16)
+            percent = 40 + (rand_r(&solver->seed) % 20);
+        else if(solver->grid_size <= 49)
+            percent = 30 + (rand_r(&solver->seed) % 10);
+        else
+            percent = 20 + (rand_r(&solver->seed) % 5);
+    }
+
+    remove_limit = (solver->grid_size * solver->grid_size) * percent / 100;
+
+    while((removed_cells < remove_limit) && still_choices)
+    {
+        // Choose a random coordinate
+        int x = rand_r(&solver->seed) % solver->grid_size;
+        int y = rand_r(&solver->seed) % solver->grid_size;
+
+        // If the random cell is already checked,
+        // move to the next cell, so it cannot have
+        // infinite loop in the case of bad random choices
+        while(checked_cells[x][y])
+        {
+            x = (x + 1) % solver->grid_size;
+            if(x == 0)
+                y = (y + 1) % solver->grid_size;
+        }
+
+        if(solver->strict)
+        {
+            // Try to solve a copy with an unique solution
+            pset_t* result_tmp = grid_copy(solver, result);
+            result_tmp[x * solver->grid_size + y] =
+                pset_full(solver->grid_size);
+
+            if(grid_solver(solver, result_tmp) == 1)
+            {
+                // If it has an unique solution, then apply the choice
+                result[x * solver->grid_size + y] =
+                    pset_full(solver->grid_size);
+                ++removed_cells;
+            }
+
+            grid_free(solver, result_tmp);
+        }
+        else
+        {
+            result[x * solver->grid_size + y] = pset_full(solver->grid_size);
+            ++removed_cells;
+        }
+
+        // The cell has been checked whatever is the result
+        // As if it had one solution it is set to full
+        // and if not, it is not necessary to re-check this cell
+        checked_cells[x][y] = true;
+
+        for(int i = 0 ; i < solver->grid_size ; ++i)
+            for(int j = 0 ; j < solver->grid_size ; ++j)
+                still_choices = still_choices || !(checked_cells[i][j]);
+    }
+
+    return result;
+}
+
+void
+grid_print(solver_t* solver, pset_t* grid)
+{
+    char string[MAX_COLORS + 1];
+    // Each cell is padded to grid_size characters, and followed by
+    // a space or by the end of its row
+    char* buffer = print_reserve(solver,
+            grid_cells(solver) * (solver->grid_size + 1));
+    char* text = buffer;
+
+    for(int i = 0 ; i < solver->grid_size ; ++i)
+    {
+        for(int j = 0 ; j < solver->grid_size ; ++j)
+        {
+            pset_t cell = grid[i * solver->grid_size + j];
+            int length = pset_cardinality(cell);
+
+            pset2str(string, cell);
+
+            memset(text, ' ', solver->grid_size - length);
+            text += solver->grid_size - length;
+            memcpy(text, string, length);
+            text += length;
+
+            *text++ = (j < (solver->grid_size - 1)) ? ' ' : '\n';
+        }
+    }
+
+    fwrite(buffer, 1, text - buffer, solver->output_stream);
+}
+
+void
+grid_print_solved(solver_t* solver, pset_t* grid)
+{
+    if(solver->generate && (solver->grid_size == 1))
+    {
+        fprintf(solver->output_stream, "_\n");
+        return;
+    }
+
+    char string[MAX_COLORS + 1];
+    // A character and a space or the end of a row for each cell
+    char* buffer = print_reserve(solver, 2 * grid_cells(solver));
+    char* text = buffer;
+
+    for(int i = 0 ; i < grid_cells(solver) ; ++i)
+    {
+        if(pset_is_singleton(grid[i]))
+        {
+            pset2str(string, grid[i]);
+            *text++ = string[0];
+        }
+        else
+            *text++ = (solver->format == FORMAT_COMPACT) ? '.' : '_';
+
+        if(solver->format != FORMAT_COMPACT)
+            *text++ = (((i + 1) % solver->grid_size) != 0) ? ' ' : '\n';
+    }
+
+    if(solver->format == FORMAT_COMPACT)
+        *text++ = '\n';
+
+    fwrite(buffer, 1, text - buffer, solver->output_stream);
+}
+
+void
+grid_write_binary(solver_t* solver, pset_t* grid, int status)
+{
+    int bits = grid_cell_bits(solver->grid_size);
+    char* buffer = print_reserve(solver,
+            grid_record_size(solver->grid_size));
+    unsigned char* record = (unsigned char*) buffer;
+    // Bits packed and not written yet
+    unsigned int pending = 0;
+    int pending_bits = 0;
+
+    *record++ = solver->grid_size;
+    *record++ = status;
+
+    for(int i = 0 ; i < grid_cells(solver) ; ++i)
+    {
+        // The index of the color of a singleton is the number of bits
+        // below it
+        unsigned int value = pset_is_singleton(grid[i]) ?
+            pset_cardinality(grid[i] - 1) + 1 : 0;
+
+        pending |= value << pending_bits;
+        pending_bits += bits;
+
+        while(pending_bits >= 8)
+        {
+            *record++ = pending & 0xff;
+            pending >>= 8;
+            pending_bits -= 8;
+        }
+    }
+
+    if(pending_bits > 0)
+        *record++ = pending;
+
+    fwrite(buffer, 1, (char*) record - buffer, solver->output_stream);
+}
+
+#ifdef DEBUG
+static bool
+subgrid_print(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    char string[MAX_COLORS + 1];
+
+    printf("subgrid:  ");
+    for(int i = 0 ; i < solver->grid_size ; ++i)
+    {
+        pset2str(string, grid[subgrid[i]]);
+        printf("(%d) = '%s'", i, string);
+
+        if(i < (solver->grid_size - 1))
+            printf(", ");
+    }
+    printf("\n");
+
+    return true;
+}
+#endif
+
+int
+grid_solver(solver_t* solver, pset_t* grid)
+{
+    if(solver->engine == ENGINE_DLX)
+        return grid_solver_dlx(solver, grid);
+
+    return grid_solver_heuristics(solver, grid);
+}
+
+static int
+grid_solver_heuristics(solver_t* solver, pset_t* grid)
+{
+    int result;
+
+    solver_reserve(solver);
+    solver->solution_found = false;
+
+    if(!search_init(solver, grid))
+        return 0;
+
+    result = grid_search(solver, grid);
+
+    // In strict mode, the search goes on after the first solution
+    // and the grid has been restored since
+    if(solver->solution_found)
+        memcpy(grid, solver->solution, grid_cells(solver) * sizeof(pset_t));
+
+    return result;
+}
+
+void
+solver_free(solver_t* solver)
+{
+    while(solver->branches != NULL)
+    {
+        branch_t* branch = solver->branches;
+
+        solver->branches = branch->next;
+        free(branch);
+    }
+
+    free(solver->trail);
+    free(solver->solution);
+    free(solver->subgrids);
+    free(solver->peers);
+    free(solver->cell_subgrids);
+    free(solver->cell_positions);
+    free(solver->planes);
+    free(solver->queue);
+    free(solver->queued);
+    free(solver->stale);
+    free(solver->buckets);
+    free(solver->bucket_next);
+    free(solver->bucket_prev);
+    free(solver->print_buffer);
+    dlx_free(solver->dlx);
+
+    solver->trail = NULL;
+    solver->solution = NULL;
+    solver->subgrids = NULL;
+    solver->peers = NULL;
+    solver->cell_subgrids = NULL;
+    solver->cell_positions = NULL;
+    solver->planes = NULL;
+    solver->queue = NULL;
+    solver->queued = NULL;
+    solver->stale = NULL;
+    solver->queue_length = 0;
+    solver->buckets = NULL;
+    solver->bucket_next = NULL;
+    solver->bucket_prev = NULL;
+    solver->print_buffer = NULL;
+    solver->print_capacity = 0;
+    solver->dlx = NULL;
+    solver->trail_length = solver->trail_capacity = 0;
+    solver->buffers_size = 0;
+}
+
+static int
+grid_search(solver_t* solver, pset_t* grid)
+{
+    // Current number of solutions
+    int result = 0;
+
+    ++solver->stats.nodes;
+
+    // An other branch of the parallel search has already ended it
+    if((solver->search != NULL) && search_stopped(solver->search))
+        return 0;
+
+    int heuristics_result = grid_heuristics(solver, grid);
+
+    // If heuristics resolve the grid, the grid has a unique solution
+    if(heuristics_result == SOLVED)
+    {
+        // The strict mode keeps the first solution found
+        // as the grid is restored to search for an other one
+        if(solver->strict && !solver->solution_found)
+        {
+            memcpy(solver->solution,
+                    grid,
+                    grid_cells(solver) * sizeof(pset_t));
+            solver->solution_found = true;
+        }
+
+        return 1;
+    }
+
+    if(heuristics_result == UNCONSISTENT)
+        return 0;
+
+    // Choose a cell in the grid to apply the backtracking
+    int coordinates = grid_choice(solver);
+    int x, y;
+
+    // Compute coordinates
+    x = coordinates / solver->grid_size;
+    y = coordinates % solver->grid_size;
+
+    int pset_card = pset_cardinality(grid[coordinates]);
+
+    // Length of the trail before the choice, to undo it
+    int trail_mark = solver->trail_length;
+    pset_t pset_left, pset_choosen;
+
+    // Test the value of the cell for each color of the set
+    pset_choosen = grid[coordinates];
+    // Random number of the color that will be choosen for the cell
+    for(int i = 0 ; i < pset_card ; ++i)
+    {
+        // The generate mode relies on the fact that the choices
+        // are made randomly
+        // Else, a determinist choice is done
+        if(solver->generate)
+        {
+            // Choose a random color in the choosen pset
+            int random_color = rand_r(&solver->seed);
+
+            random_color = (random_color % pset_cardinality(pset_choosen)) + 1;
+            pset_left = pset_n_leftmost(pset_choosen, random_color);
+        }
+        else
+        {
+            pset_left = pset_leftmost(pset_choosen);
+        }
+
+        if(solver->verbose)
+        {
+            char str_pset[MAX_COLORS + 1];
+            char str_left[MAX_COLORS + 1];
+
+            pset2str(str_pset, grid[coordinates]);
+            pset2str(str_left, pset_left);
+
+            fprintf(solver->output_stream,
+                    "Next choice at grid[%d][%d]"
+                    " = '%s' and choice is '%s'.\n",
+                    x,
+                    y,
+                    str_pset,
+                    str_left);
+        }
+
+        // Only the subgrids of the choosen cell have to be processed
+        solver->kernels->cell_assign(solver, grid, coordinates, pset_left);
+
+        if(solver->verbose)
+            grid_print(solver, grid);
+
+        int number_of_solutions;
+        // Check if the new grid has at least one solution
+        if((number_of_solutions = grid_search(solver, grid)) >= 1)
+        {
+            result += number_of_solutions;
+
+            // If strict mode is set and still not 2 solutions, then continue
+            // Else the grid holds the solution found
+            if(!solver->strict || (result > 1))
+                return result;
+        }
+        else
+        {
+            if(solver->verbose)
+                fprintf(solver->output_stream, "Bad choice.\n");
+        }
+
+        // Undo the choice and everything the heuristics deduced from it
+        solver->kernels->trail_undo(solver, grid, trail_mark);
+
+        // remove the choice for the color of the cell
+        pset_choosen = pset_substract(pset_choosen, pset_left);
+    }
+
+    return result;
+}
+
+int
+grid_reduce(solver_t* solver, pset_t* grid)
+{
+    solver_reserve(solver);
+
+    if(!search_init(solver, grid))
+        return UNCONSISTENT;
+
+    return grid_heuristics(solver, grid);
+}
+
+static bool
+search_init(solver_t* solver, pset_t* grid)
+{
+    // The grid searched is never restored below this point
+    solver->trail_length = 0;
+    solver->contradiction = false;
+    solver->unsolved = grid_unsolved(solver, grid);
+
+    for(int i = 0 ; i <= solver->grid_size ; ++i)
+        solver->buckets[i] = -1;
+
+    for(int i = 0 ; i < grid_cells(solver) ; ++i)
+        bucket_insert(solver, i, pset_cardinality(grid[i]));
+
+    planes_build(solver, grid);
+
+    queue_clear(solver);
+    queue_fill(solver);
+
+    // The search only checks the cells it modifies
+    return grid_consistency(solver, grid);
+}
+
+static void
+planes_build(solver_t* solver, pset_t* grid)
+{
+    memset(solver->planes,
+            0,
+            3 * solver->grid_size * solver->grid_size * sizeof(pset_t));
+
+    for(int cell = 0 ; cell < grid_cells(solver) ; ++cell)
+        for(int i = 0 ; i < 3 ; ++i)
+        {
+            pset_t* planes = &solver->planes[
+                solver->cell_subgrids[3 * cell + i] * solver->grid_size];
+            pset_t position =
+                ((pset_t) 1) << solver->cell_positions[3 * cell + i];
+
+            for(pset_t colors = grid[cell] ; colors != 0 ; colors &= colors - 1)
+                planes[pset_index(colors)] |= position;
+        }
+}
+
+static void
+bucket_insert(solver_t* solver, int cell, int cardinality)
+{
+    int head = solver->buckets[cardinality];
+
+    if(head == -1)
+    {
+        solver->bucket_prev[cell] = solver->bucket_next[cell] = cell;
+        solver->buckets[cardinality] = cell;
+    }
+    else
+    {
+        // The cell becomes the tail, so that the cells of a bucket are
+        // choosen in the order they reached its cardinality
+        int tail = solver->bucket_prev[head];
+
+        solver->bucket_prev[cell] = tail;
+        solver->bucket_next[cell] = head;
+        solver->bucket_next[tail] = cell;
+        solver->bucket_prev[head] = cell;
+    }
+}
+
+static void
+bucket_remove(solver_t* solver, int cell, int cardinality)
+{
+    int prev = solver->bucket_prev[cell];
+    int next = solver->bucket_next[cell];
+
+    if(next == cell)
+        solver->buckets[cardinality] = -1;
+    else
+    {
+        solver->bucket_next[prev] = next;
+        solver->bucket_prev[next] = prev;
+
+        if(solver->buckets[cardinality] == cell)
+            solver->buckets[cardinality] = next;
+    }
+}
+
+static void
+subgrid_enqueue(solver_t* solver, int subgrid)
+{
+    int subgrids_number = 3 * solver->grid_size;
+
+    solver->stale[subgrid] = true;
+
+    if(solver->queued[subgrid])
+        return;
+
+    // A subgrid is queued at most once, so the ring never overflows
+    solver->queue[(solver->queue_head + solver->queue_length)
+        % subgrids_number] = subgrid;
+    ++solver->queue_length;
+    solver->queued[subgrid] = true;
+}
+
+static void
+queue_fill(solver_t* solver)
+{
+    for(int i = 0 ; i < 3 * solver->grid_size ; ++i)
+        subgrid_enqueue(solver, i);
+}
+
+static void
+queue_clear(solver_t* solver)
+{
+    int subgrids_number = 3 * solver->grid_size;
+
+    while(solver->queue_length > 0)
+    {
+        solver->queued[solver->queue[solver->queue_head]] = false;
+        solver->queue_head = (solver->queue_head + 1) % subgrids_number;
+        --solver->queue_length;
+    }
+
+    memset(solver->stale, 0, subgrids_number * sizeof(bool));
+}
+
+int
+grid_solver_parallel(solver_t* solvers, pool_t* pool, pset_t* grid)
+{
+    solver_t* solver = &solvers[0];
+    search_t search;
+    branch_t root;
+
+    // The root branch works directly on the grid
+    root.search = &search;
+    root.grid = grid;
+    root.depth = 0;
+
+    search.solvers = solvers;
+    search.pool = pool;
+    search.target = solver->strict ? 2 : 1;
+    search.solutions = 0;
+    search.solution = NULL;
+    search.root = &root;
+    pthread_mutex_init(&search.lock, NULL);
+
+    pool_submit(pool, branch_run, &root);
+    pool_wait(pool);
+
+    // The workers are idle, their lists can be used
+    if((search.solution != NULL) && (search.solution != &root))
+    {
+        memcpy(grid,
+                search.solution->grid,
+                grid_cells(solver) * sizeof(pset_t));
+
+        branch_release(solver, search.solution);
+    }
+
+    pthread_mutex_destroy(&search.lock);
+
+    return search.solutions;
+}
+
+static void
+branch_run(void* arg, int worker)
+{
+    branch_t* branch = arg;
+    search_t* search = branch->search;
+    solver_t* solver = &search->solvers[worker];
+    int solutions = 0;
+
+    if(!search_stopped(search))
+    {
+        if(branch->depth < solver->split_depth)
+            solutions = branch_split(solver, branch);
+        else
+        {
+            solver->search = search;
+            solutions = grid_solver(solver, branch->grid);
+            solver->search = NULL;
+        }
+    }
+
+    if(solutions > 0)
+    {
+        pthread_mutex_lock(&search->lock);
+
+        // Keep the first solution found
+        if(search->solution == NULL)
+        {
+            search->solution = branch;
+            branch = NULL;
+        }
+
+        __atomic_add_fetch(&search->solutions, solutions, __ATOMIC_SEQ_CST);
+
+        pthread_mutex_unlock(&search->lock);
+    }
+
+    if((branch != NULL) && (branch != search->root))
+        branch_release(solver, branch);
+}
+
+static int
+branch_split(solver_t* solver, branch_t* branch)
+{
+    pset_t* grid = branch->grid;
+
+    solver_reserve(solver);
+    ++solver->stats.nodes;
+
+    // The grid of the branch is never restored
+    if(!search_init(solver, grid))
+        return 0;
+
+    int heuristics_result = grid_heuristics(solver, grid);
+
+    if(heuristics_result == SOLVED)
+        return 1;
+
+    if(heuristics_result == UNCONSISTENT)
+        return 0;
+
+    int coordinates = grid_choice(solver);
+    pset_t pset_choosen = grid[coordinates];
+
+    // Each color of the cell is a new branch
+    while(!pset_equals(pset_choosen, pset_empty()))
+    {
+        pset_t pset_left = pset_leftmost(pset_choosen);
+        branch_t* child = branch_alloc(solver);
+
+        child->search = branch->search;
+        memcpy(child->grid, grid, grid_cells(solver) * sizeof(pset_t));
+        child->grid[coordinates] = pset_left;
+        child->depth = branch->depth + 1;
+
+        pool_submit(branch->search->pool, branch_run, child);
+
+        pset_choosen = pset_substract(pset_choosen, pset_left);
+    }
+
+    return 0;
+}
+
+static branch_t*
+branch_alloc(solver_t* solver)
+{
+    branch_t* result = solver->branches;
+
+    // A branch of an other size cannot be reused
+    if((result != NULL) && (result->grid_size != solver->grid_size))
+    {
+        solver->branches = result->next;
+        free(result);
+        result = NULL;
+    }
+
+    if(result != NULL)
+        solver->branches = result->next;
+    else
+    {
+        result = solver_malloc(solver,
+                sizeof(branch_t) + grid_cells(solver) * sizeof(pset_t));
+        result->grid_size = solver->grid_size;
+        result->grid = result->cells;
+    }
+
+    return result;
+}
+
+static void
+branch_release(solver_t* solver, branch_t* branch)
+{
+    branch->next = solver->branches;
+    solver->branches = branch;
+}
+
+static void
+solver_reserve(solver_t* solver)
+{
+    if(solver->buffers_size == solver->grid_size)
+        return;
+
+    free(solver->trail);
+    free(solver->solution);
+
+    free(solver->subgrids);
+    free(solver->peers);
+    free(solver->cell_subgrids);
+    free(solver->cell_positions);
+    free(solver->planes);
+    free(solver->queue);
+    free(solver->queued);
+    free(solver->stale);
+    free(solver->buckets);
+    free(solver->bucket_next);
+    free(solver->bucket_prev);
+
+    solver->kernels = kernels_select(solver->grid_size);
+
+    // The trail grows with the depth of the search, but it is kept
+    // from a search to another
+    solver->trail_capacity = grid_cells(solver);
+    solver->trail = solver_malloc(solver,
+            solver->trail_capacity * solver->kernels->trail_entry_size);
+    solver->solution = solver_malloc(solver,
+            grid_cells(solver) * sizeof(pset_t));
+
+    subgrids_build(solver);
+
+    solver->planes = solver_malloc(solver,
+            3 * solver->grid_size * solver->grid_size * sizeof(pset_t));
+
+    solver->queue = solver_malloc(solver,
+            3 * solver->grid_size * sizeof(int));
+    solver->queued = solver_malloc(solver,
+            3 * solver->grid_size * sizeof(bool));
+    memset(solver->queued, 0, 3 * solver->grid_size * sizeof(bool));
+    solver->stale = solver_malloc(solver,
+            3 * solver->grid_size * sizeof(bool));
+    memset(solver->stale, 0, 3 * solver->grid_size * sizeof(bool));
+    solver->queue_head = solver->queue_length = 0;
+
+    solver->buckets = solver_malloc(solver,
+            (solver->grid_size + 1) * sizeof(int));
+    solver->bucket_next = solver_malloc(solver,
+            grid_cells(solver) * sizeof(int));
+    solver->bucket_prev = solver_malloc(solver,
+            grid_cells(solver) * sizeof(int));
+
+    solver->buffers_size = solver->grid_size;
+}
+
+static void
+subgrids_build(solver_t* solver)
+{
+    int block_size = (int)sqrt(solver->grid_size);
+    int* subgrid;
+
+    solver->subgrids = solver_malloc(solver,
+            3 * grid_cells(solver) * sizeof(int));
+    subgrid = solver->subgrids;
+
+    // Rows
+    for(int i = 0 ; i < solver->grid_size ; ++i)
+        for(int j = 0 ; j < solver->grid_size ; ++j)
+            *subgrid++ = i * solver->grid_size + j;
+
+    // Columns
+    for(int j = 0 ; j < solver->grid_size ; ++j)
+        for(int i = 0 ; i < solver->grid_size ; ++i)
+            *subgrid++ = i * solver->grid_size + j;
+
+    // Blocks
+    for(int i = 0 ; i < block_size ; ++i)
+        for(int j = 0 ; j < block_size ; ++j)
+            for(int k = 0 ; k < solver->grid_size ; ++k)
+            {
+                // Coordinates of the top left cell of the block
+                // plus the position of the cell in the block
+                int cell_i = i * block_size + (k / block_size);
+                int cell_j = j * block_size + (k % block_size);
+
+                *subgrid++ = cell_i * solver->grid_size + cell_j;
+            }
+
+    // The peers of a cell are the other cells of its row, of its column
+    // and the cells of its block which are in neither of them
+    solver->peers_number = 2 * (solver->grid_size - 1)
+        + (block_size - 1) * (block_size - 1);
+    solver->peers = solver_malloc(solver,
+            grid_cells(solver) * solver->peers_number * sizeof(int));
+
+    for(int cell = 0 ; cell < grid_cells(solver) ; ++cell)
+    {
+        int* peer = &solver->peers[cell * solver->peers_number];
+        int x = cell / solver->grid_size;
+        int y = cell % solver->grid_size;
+
+        for(int k = 0 ; k < solver->grid_size ; ++k)
+        {
+            if(k != y)
+                *peer++ = x * solver->grid_size + k;
+
+            if(k != x)
+                *peer++ = k * solver->grid_size + y;
+        }
+
+        for(int k = 0 ; k < solver->grid_size ; ++k)
+        {
+            int cell_i = (x / block_size) * block_size + (k / block_size);
+            int cell_j = (y / block_size) * block_size + (k % block_size);
+
+            if((cell_i != x) && (cell_j != y))
+                *peer++ = cell_i * solver->grid_size + cell_j;
+        }
+    }
+
+    // Row, column and block of each cell, numbered as in subgrids,
+    // and position of the cell in each one of them
+    solver->cell_subgrids = solver_malloc(solver,
+            3 * grid_cells(solver) * sizeof(int));
+    solver->cell_positions = solver_malloc(solver,
+            3 * grid_cells(solver) * sizeof(int));
+
+    for(int cell = 0 ; cell < grid_cells(solver) ; ++cell)
+    {
+        int x = cell / solver->grid_size;
+        int y = cell % solver->grid_size;
+
+        solver->cell_subgrids[3 * cell] = x;
+        solver->cell_subgrids[3 * cell + 1] = solver->grid_size + y;
+        solver->cell_subgrids[3 * cell + 2] = 2 * solver->grid_size
+            + (x / block_size) * block_size + (y / block_size);
+
+        solver->cell_positions[3 * cell] = y;
+        solver->cell_positions[3 * cell + 1] = x;
+        solver->cell_positions[3 * cell + 2] = (x % block_size) * block_size
+            + (y % block_size);
+    }
+}
+
+void*
+solver_malloc(solver_t* solver, size_t size)
+{
+    void* result = malloc(size);
+
+    if(result == NULL)
+        grid_error("out of memory !");
+
+    ++solver->stats.allocations;
+
+    return result;
+}
+
+static void*
+solver_realloc(solver_t* solver, void* pointer, size_t size)
+{
+    void* result = realloc(pointer, size);
+
+    if(result == NULL)
+        grid_error("out of memory !");
+
+    ++solver->stats.allocations;
+
+    return result;
+}
+
+static char*
+print_reserve(solver_t* solver, size_t size)
+{
+    if(size > solver->print_capacity)
+    {
+        solver->print_buffer = solver_realloc(solver,
+                solver->print_buffer,
+                size);
+        solver->print_capacity = size;
+    }
+
+    return solver->print_buffer;
+}
+
+static bool
+search_stopped(search_t* search)
+{
+    return __atomic_load_n(&search->solutions, __ATOMIC_SEQ_CST)
+        >= search->target;
+}
+
+static int
+grid_heuristics(solver_t* solver, pset_t* grid)
+{
+    int subgrids_number = 3 * solver->grid_size;
+    const pipeline_t* pipeline = pipeline_select(solver);
+
+    // Fixpoint is reached when no subgrid has been modified since
+    // the heuristics were last applied to it
+    do
+    {
+        while((solver->queue_length > 0) && !solver->contradiction)
+        {
+            int i = solver->queue[solver->queue_head];
+
+            solver->queue_head = (solver->queue_head + 1) % subgrids_number;
+            --solver->queue_length;
+            // Dequeued before being processed, so that it is queued again
+            // if the heuristics modify it
+            solver->queued[i] = false;
+
+            subgrid_heuristics(solver,
+                    grid,
+                    &solver->subgrids[i * solver->grid_size],
+                    pipeline,
+                    0,
+                    pipeline->stage);
+        }
+
+        // The second stage is only applied at the fixpoint of the first
+        // one, which gets the subgrids it modifies back in the queue
+        if(pipeline->stage < pipeline->length)
+            for(int i = 0 ; (i < subgrids_number) && !solver->contradiction ;
+                    ++i)
+                if(solver->stale[i])
+                {
+                    solver->stale[i] = false;
+                    subgrid_heuristics(solver,
+                            grid,
+                            &solver->subgrids[i * solver->grid_size],
+                            pipeline,
+                            pipeline->stage,
+                            pipeline->length);
+                }
+    }
+    while((solver->queue_length > 0) && !solver->contradiction);
+
+    if(solver->verbose)
+    {
+        grid_print(solver, grid);
+        fprintf(solver->output_stream, "\n");
+    }
+
+    if(solver->contradiction)
+        return UNCONSISTENT;
+
+    return (solver->unsolved == 0) ? SOLVED : CONSISTENT;
+}
+
+static void
+subgrid_heuristics(solver_t* solver,
+        pset_t* grid,
+        const int* subgrid,
+        const pipeline_t* pipeline,
+        int first,
+        int last)
+{
+    const kernels_t* kernels = solver->kernels;
+
+    for(int i = first ; (i < last) && !solver->contradiction ; ++i)
+    {
+        heuristic_t heuristic = pipeline->heuristics[i];
+        heuristic_stats_t* stats = &solver->stats.heuristics[heuristic];
+        unsigned long removed = solver->stats.removed;
+        struct timespec start, end;
+
+        if(solver->profile)
+            clock_gettime(CLOCK_MONOTONIC, &start);
+
+        kernels->heuristics[heuristic](solver, grid, subgrid);
+
+        if(solver->profile)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            stats->time += (end.tv_sec - start.tv_sec)
+                + (end.tv_nsec - start.tv_nsec) / 1e9;
+        }
+
+        ++stats->calls;
+        stats->removed += solver->stats.removed - removed;
+    }
+}
+
+static const pipeline_t*
+pipeline_select(solver_t* solver)
+{
+    // Most of the small grids are solved by the two cheapest heuristics
+    // and a few choices, which cost less than the other heuristics
+    static const pipeline_t small = {
+        {HEURISTIC_CROSS_HATCHING, HEURISTIC_LONE_NUMBER},
+        2,
+        2};
+    // The large grids have the other heuristics applied at the fixpoint
+    // of the two cheapest ones
+    static const pipeline_t large = {
+        {HEURISTIC_CROSS_HATCHING,
+            HEURISTIC_LONE_NUMBER,
+            HEURISTIC_N_POSSIBLE,
+            HEURISTIC_INTERSECTIONS,
+            HEURISTIC_HIDDEN_SUBSETS,
+            HEURISTIC_X_WING},
+        6,
+        2};
+
+    if(solver->pipeline != NULL)
+        return solver->pipeline;
+
+    return (solver->grid_size < 16) ? &small : &large;
+}
+
+bool
+pipeline_parse(pipeline_t* pipeline, const char* list)
+{
+    bool used[HEURISTICS_NUMBER] = {false};
+    const char* name = list;
+
+    pipeline->length = 0;
+    pipeline->stage = -1;
+
+    while(true)
+    {
+        size_t length = strcspn(name, ",/");
+        int heuristic = 0;
+
+        while((heuristic < HEURISTICS_NUMBER)
+                && ((strlen(heuristic_name(heuristic)) != length)
+                    || (strncmp(name, heuristic_name(heuristic), length) != 0)))
+            ++heuristic;
+
+        if((heuristic == HEURISTICS_NUMBER) || used[heuristic])
+            return false;
+
+        used[heuristic] = true;
+        pipeline->heuristics[pipeline->length++] = heuristic;
+        name += length;
+
+        if(*name == '\0')
+            break;
+
+        // A single '/' ends the first stage
+        if(*name == '/')
+        {
+            if(pipeline->stage >= 0)
+                return false;
+
+            pipeline->stage = pipeline->length;
+        }
+
+        ++name;
+    }
+
+    if(pipeline->stage < 0)
+        pipeline->stage = pipeline->length;
+
+    // Only cross_hatching() removes the color of a singleton from its
+    // peers, without which the search is almost blind
+    return used[HEURISTIC_CROSS_HATCHING];
+}
+
+const char*
+heuristic_name(heuristic_t heuristic)
+{
+    static const char* const names[HEURISTICS_NUMBER] = {
+        "cross_hatching",
+        "lone_number",
+        "n_possible",
+        "intersections",
+        "hidden_subsets",
+        "x_wing"};
+
+    return names[heuristic];
+}
+
+static int 
+grid_choice(solver_t* solver)
+{
+    int result = -1;
+
+    // The first bucket which is not empty holds the cells with the fewest
+    // colors, in most grids the one of the pairs
+    for(int i = 2 ; (i <= solver->grid_size) && (result == -1) ; ++i)
+        result = solver->buckets[i];
+
+    return result;
+}
+
+static bool
+grid_consistency(solver_t* solver, pset_t* grid)
+{
+    bool result = true;
+
+    for(int i = 0 ; (i < 3 * solver->grid_size) && result ; ++i)
+        result = solver->kernels->subgrid_consistency(solver,
+                grid,
+                &solver->subgrids[i * solver->grid_size]);
+
+    return result;
+}
+
+static int
+grid_unsolved(solver_t* solver, pset_t* grid)
+{
+    int result = 0;
+
+    for(int i = 0 ; i < grid_cells(solver) ; ++i)
+        if(!pset_is_singleton(grid[i]))
+            ++result;
+
+    return result;
+}
+
+#ifdef SOLVER_VECTOR
+static inline pset_vector_t
+vector_broadcast(pset_t pset)
+{
+    pset_vector_t result;
+
+    for(int i = 0 ; i < VECTOR_LANES ; ++i)
+        result[i] = pset;
+
+    return result;
+}
+
+static inline pset_vector_t
+vector_singletons(pset_vector_t vector)
+{
+    // The comparisons give -1 in the lanes where they hold
+    return (pset_vector_t) ((vector != 0) & ((vector & (vector - 1)) == 0));
+}
+
+static inline pset_t
+vector_or_lanes(pset_vector_t vector)
+{
+    pset_t result = pset_empty();
+
+    for(int i = 0 ; i < VECTOR_LANES ; ++i)
+        result = pset_or(result, vector[i]);
+
+    return result;
+}
+#endif
+
+static inline int
+pset_hash(pset_t pset, int bits)
+{
+    // Fibonacci hashing: the high bits of the product depend on every bit
+    // of the pset
+    return (int)((pset * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - bits));
+}
+
+static inline bool
+pset_at_most(pset_t pset, int colors)
+{
+    // Each step removes the rightmost color
+    for(int i = 0 ; i < colors ; ++i)
+        pset &= pset - 1;
+
+    return pset == 0;
+}
+
+static const kernels_t*
+kernels_select(int size)
+{
+    switch(size)
+    {
+        case 1:
+            return &kernels_1;
+        case 4:
+            return &kernels_4;
+        case 9:
+            return &kernels_9;
+        case 16:
+            return &kernels_16;
+        case 25:
+            return &kernels_25;
+        case 36:
+            return &kernels_36;
+        case 49:
+            return &kernels_49;
+        default:
+            return &kernels_64;
+    }
+}
+
+bool
+grid_valid_size(int size)
+{
+    bool result = false;
+    // Valid sizes for the grids
+    unsigned short valid_size_number = 8;
+    unsigned short valid_sizes[] = {1, 4, 9, 16, 25, 36, 49, 64};
+
+    for(int i = 0 ; (i < valid_size_number) && !result ; ++i)
+        if(size == valid_sizes[i])
+            result = true;
+
+    return result;
+}
+
+int
+grid_cell_bits(int size)
+{
+    int result = 1;
+
+    // Enough bits for the values from 0 to size
+    while((1 << result) <= size)
+        ++result;
+
+    return result;
+}
+
+int
+grid_record_size(int size)
+{
+    return 2 + (size * size * grid_cell_bits(size) + 7) / 8;
+}
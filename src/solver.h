@@ -0,0 +1,254 @@
+/* SOLVER_H */
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <preemptive_set.h>
+
+#include "pool.h"
+
+struct search;
+struct branch;
+struct dlx;
+struct kernels;
+
+// Formats of the grids printed
+typedef enum
+{
+    // Rows of cells separated by spaces, with messages between the grids
+    FORMAT_TEXT,
+    // A line per grid
+    FORMAT_COMPACT,
+    // Records of the binary format
+    FORMAT_BINARY
+} format_t;
+
+// Engines searching the solutions of a grid
+typedef enum
+{
+    // Heuristics on the subgrids, and backtracking on the cells
+    ENGINE_HEURISTICS,
+    // Exact cover search with the dancing links
+    ENGINE_DLX
+} engine_t;
+
+// Heuristics applied to the subgrids
+typedef enum
+{
+    HEURISTIC_CROSS_HATCHING,
+    HEURISTIC_LONE_NUMBER,
+    HEURISTIC_N_POSSIBLE,
+    HEURISTIC_INTERSECTIONS,
+    HEURISTIC_HIDDEN_SUBSETS,
+    HEURISTIC_X_WING,
+    HEURISTICS_NUMBER
+} heuristic_t;
+
+// Heuristics applied to the subgrids, in order
+// The heuristics of the first stage are applied until they deduce nothing
+// more, then the ones of the second stage to the subgrids modified since
+// they were last applied to them, and so on until no heuristic deduces
+// anything more
+typedef struct
+{
+    heuristic_t heuristics[HEURISTICS_NUMBER];
+    int length;
+    // Number of heuristics of the first stage, length if there is only one
+    int stage;
+} pipeline_t;
+
+// Counters of a heuristic
+typedef struct
+{
+    // Number of subgrids the heuristic has been applied to
+    unsigned long calls;
+    // Number of colors it has removed from the cells
+    unsigned long removed;
+    // Time spent in the heuristic, only measured by the solvers profiling
+    double time;
+} heuristic_stats_t;
+
+// Counters of a solver
+typedef struct
+{
+    // Number of grids read
+    unsigned long grids;
+    // Number of nodes explored by the search
+    unsigned long nodes;
+    // Number of heap allocations made by the solver for its buffers,
+    // through solver_malloc()
+    unsigned long allocations;
+    // Number of colors removed from the cells, by the heuristics
+    // and by the choices of the search
+    unsigned long removed;
+    heuristic_stats_t heuristics[HEURISTICS_NUMBER];
+} solver_stats_t;
+
+// Context of a solve
+// Every state of the solver lives in its context, so that several
+// grids can be solved at the same time by different threads, each
+// one of them with its own context
+typedef struct
+{
+    // Size of the current grid
+    unsigned short grid_size;
+    bool verbose, generate, strict;
+    // Format of the grids printed
+    format_t format;
+    // Engine of grid_solver()
+    engine_t engine;
+    // Stream where the grids and the verbose output are printed
+    FILE* output_stream;
+    // Seed of the random choices of the generate mode
+    unsigned int seed;
+    // Heuristics applied to the subgrids, NULL for the default pipeline
+    // of the grid size
+    const pipeline_t* pipeline;
+    // Measure the time spent in each heuristic
+    bool profile;
+    // Number of levels of the backtracking solved as parallel tasks
+    // by grid_solver_parallel()
+    int split_depth;
+    // Parallel search the solver is taking part in, NULL if none
+    struct search* search;
+    // The buffers below are allocated for a grid size and reused
+    // from a solve to another, so that the search does not allocate
+    unsigned short buffers_size;
+    // Cells modified by the search, undone when backtracking
+    // The type of its entries depends on the grid size
+    void* trail;
+    int trail_length, trail_capacity;
+    // First solution found in strict mode
+    pset_t* solution;
+    bool solution_found;
+    // Indexes of the cells of every subgrid: the rows, the columns
+    // then the blocks, grid_size cells each
+    int* subgrids;
+    // Indexes of the peers_number cells sharing a subgrid with each cell
+    int* peers;
+    int peers_number;
+    // Indexes in subgrids of the row, the column and the block of each cell
+    int* cell_subgrids;
+    // Position of each cell in its row, its column and its block
+    int* cell_positions;
+    // Digit planes: for each subgrid and each color, the positions in the
+    // subgrid of the cells where the color is still possible
+    // They are kept in sync with the cells, and restored with them
+    pset_t* planes;
+    // Ring of the subgrids modified since the heuristics were last applied
+    // to them, and whether each subgrid is in the ring
+    int* queue;
+    int queue_head, queue_length;
+    bool* queued;
+    // Subgrids modified since the heuristics of the second stage of the
+    // pipeline were last applied to them
+    bool* stale;
+    // Set when a cell modified by the search becomes empty, or a singleton
+    // already placed in its subgrids, reset when the search backtracks
+    bool contradiction;
+    // Number of cells which are not singletons
+    int unsolved;
+    // Cells of the grid sorted by cardinality: buckets[c] is the first
+    // cell with c colors (-1 if none), and the cells of a bucket form
+    // a circular list linked by bucket_next and bucket_prev
+    int* buckets;
+    int* bucket_next;
+    int* bucket_prev;
+    // Heuristics and checks specialized for the grid size
+    const struct kernels* kernels;
+    // Text of a grid being printed, written at once
+    char* print_buffer;
+    size_t print_capacity;
+    // Branches of parallel searches ready to be reused
+    struct branch* branches;
+    // Links of the dancing links engine, NULL until it is used
+    struct dlx* dlx;
+    solver_stats_t stats;
+} solver_t;
+
+// Allocate a grid of size grid_size
+// The cells are stored row after row, cell (i, j) is at i * grid_size + j
+pset_t* grid_alloc(solver_t*);
+
+void grid_free(solver_t*, pset_t*);
+
+pset_t* grid_copy(solver_t*, pset_t*);
+
+// Return : the number of cells of a grid of size grid_size
+int grid_cells(solver_t*);
+
+// Generate a grid of size grid_size
+// If the strict mode is set, the grid has a unique solution
+pset_t* grid_generate(solver_t*);
+
+void grid_print(solver_t*, pset_t*);
+
+// Print a grid solved to have readable output format
+// In compact format, the grid is printed on one line, '.' standing for the
+// cells which are not singletons
+void grid_print_solved(solver_t*, pset_t*);
+
+// Write a grid as a record of the binary format
+// Parameter : the grid
+// Parameter : the status of the grid
+void grid_write_binary(solver_t*, pset_t*, int);
+
+// Search for a solution, with the engine of the solver
+// The backtracking works on the grid itself: the cells modified by a
+// choice are recorded in a trail and restored if the choice was wrong.
+// If the strict mode is set, then it will search for 2 solutions.
+// If 2 solutions are found, it returns 2
+// Else, it returns the number of solutions found (0 or 1)
+// If the strict mode is not set, it searches the first solution.
+// If the generate mode is set, the backtracking makes random choices
+// Parameter : the grid to solve
+// Return : return a number of solutions
+int grid_solver(solver_t*, pset_t*);
+
+// Apply the heuristics to a grid until they do not deduce anything more
+// Parameter : the grid to reduce
+// Return : SOLVED, CONSISTENT or UNCONSISTENT
+int grid_reduce(solver_t*, pset_t*);
+
+// Read a pipeline of heuristics from a list of their names, separated by
+// ',', a '/' ending the first stage of the pipeline
+// Parameter : the pipeline read
+// Parameter : the list of names
+// Return : false if a name is unknown or repeated, a stage is empty,
+//          or cross_hatching is not in the list
+bool pipeline_parse(pipeline_t*, const char*);
+
+// Return : the name of a heuristic, as read by pipeline_parse()
+const char* heuristic_name(heuristic_t);
+
+// Free the buffers owned by a solver
+void solver_free(solver_t*);
+
+// Allocate memory for a solver, counted in its statistics
+// The software exits if there is no memory left
+void* solver_malloc(solver_t*, size_t);
+
+// Search for a solution with the workers of a pool
+// The branches of the split_depth first levels of the backtracking are
+// submitted as tasks to the pool, and the search is cancelled as soon as
+// enough solutions have been found (1, or 2 if the strict mode is set)
+// Parameter : the contexts of the workers of the pool
+// Parameter : the pool
+// Parameter : the grid to solve
+// Return : return a number of solutions, as grid_solver()
+int grid_solver_parallel(solver_t*, pool_t*, pset_t*);
+
+// Check if the length of the grid is a correct length
+bool grid_valid_size(int);
+
+// Return : the number of bits of a cell of a grid of a given size,
+//          in the binary format
+int grid_cell_bits(int);
+
+// Return : the number of bytes of the record of a grid of a given size,
+//          in the binary format
+int grid_record_size(int);
+
+#endif
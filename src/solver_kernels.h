@@ -0,0 +1,786 @@
+// Heuristics and checks of the subgrids, specialized for a grid size
+// This file is included by solver.c once per valid size, with SIZE defined
+// to the size and BLOCK_SIZE to the size of its blocks: the loops over the
+// cells of a subgrid have a bound known at compile time, which the compiler
+// unrolls, the full pset of the size is a constant, and the trail records
+// the cells in the narrowest type holding their colors. It defines the
+// functions below suffixed by the size, and their table kernels_SIZE.
+
+#define KERNEL(name) KERNEL_NAME(name, SIZE)
+#define KERNEL_NAME(name, size) KERNEL_CONCAT(name, size)
+#define KERNEL_CONCAT(name, size) name ## _ ## size
+
+// Type of a cell of the size
+#if SIZE <= 16
+#define CELL uint16_t
+#elif SIZE <= 32
+#define CELL uint32_t
+#else
+#define CELL uint64_t
+#endif
+
+// Cell modified by the search, with its value before the modification,
+// in the narrowest types holding the cells and the colors of the size
+typedef struct
+{
+    uint16_t cell;
+    CELL value;
+} KERNEL(trail_t);
+
+// Change the value of a cell, remembering the old one in the trail,
+// and queue the subgrids of the cell for the heuristics
+// An empty cell, or a new singleton already placed in a peer of the cell,
+// is a contradiction
+static void KERNEL(cell_assign)(solver_t*, pset_t*, int, pset_t);
+
+// Restore the cells modified since the trail had a given length
+static void KERNEL(trail_undo)(solver_t*, pset_t*, int);
+
+// Update the digit planes of the subgrids of a cell
+// Parameter : the cell
+// Parameter : the colors added to the cell or removed from it
+static void KERNEL(planes_update)(solver_t*, int, pset_t);
+
+// Copy the cells of a subgrid, which the heuristics read from the copy
+// and keep up to date when they modify them
+static void KERNEL(subgrid_gather)(pset_t*, const int*, pset_t*);
+
+// Number of bits of the slots of the hash table grouping the cells of a
+// subgrid by pset, which has at least twice as many slots as cells
+#if SIZE <= 4
+#define TABLE_BITS 3
+#elif SIZE <= 16
+#define TABLE_BITS 5
+#else
+#define TABLE_BITS 7
+#endif
+
+// Maximum number of naked subsets of a subgrid found at once
+#define SUBSETS (2 * SIZE)
+
+// Find the psets of several colors held by as many cells of a subgrid as
+// their colors, or more, grouping the cells by pset in a hash table
+// Parameter : the cells of the subgrid
+// Parameter : the subsets found, appended to the array
+// Parameter : the number of subsets in the array
+// Return : the new number of subsets
+static int KERNEL(naked_equal)(const pset_t*, pset_t*, int);
+
+#if SIZE > 1
+// Find the unions of the colors of 2 to 4 cells of a subgrid which do not
+// have more colors than cells, the larger subsets being only found by
+// naked_equal() when their cells are equal
+// Same parameters and return as naked_equal()
+static int KERNEL(naked_union)(const pset_t*, pset_t*, int);
+#endif
+
+// Append a subset to the subsets found, unless it is already there or the
+// array is full
+// Same parameters and return as naked_equal()
+static int KERNEL(naked_add)(pset_t, pset_t*, int);
+
+#if defined(SOLVER_VECTOR) && (SIZE >= VECTOR_MIN_SIZE)
+// Number of vectors holding the cells of a subgrid
+#define VECTORS ((SIZE + VECTOR_LANES - 1) / VECTOR_LANES)
+
+// Copy the cells of a subgrid in the lanes of vectors
+static void KERNEL(subgrid_gather_vectors)(pset_t*,
+        const int*,
+        pset_vector_t*);
+#endif
+
+static bool KERNEL(cross_hatching)(solver_t*, pset_t*, const int*);
+
+static bool KERNEL(lone_number)(solver_t*, pset_t*, const int*);
+
+static bool KERNEL(n_possible)(solver_t*, pset_t*, const int*);
+
+// Pointing pairs and triples, and box-line reduction
+static bool KERNEL(intersections)(solver_t*, pset_t*, const int*);
+
+// Hidden pairs, triples and quads
+static bool KERNEL(hidden_subsets)(solver_t*, pset_t*, const int*);
+
+static bool KERNEL(x_wing)(solver_t*, pset_t*, const int*);
+
+static bool KERNEL(subgrid_consistency)(solver_t*, pset_t*, const int*);
+
+static const kernels_t KERNEL(kernels) = {
+    {KERNEL(cross_hatching),
+        KERNEL(lone_number),
+        KERNEL(n_possible),
+        KERNEL(intersections),
+        KERNEL(hidden_subsets),
+        KERNEL(x_wing)},
+    KERNEL(subgrid_consistency),
+    KERNEL(cell_assign),
+    KERNEL(trail_undo),
+    sizeof(KERNEL(trail_t))};
+
+static void
+KERNEL(cell_assign)(solver_t* solver, pset_t* grid, int cell, pset_t pset)
+{
+    const int* subgrids = &solver->cell_subgrids[3 * cell];
+    KERNEL(trail_t)* entry;
+    int cardinality, new_cardinality;
+
+    // Double the size of the trail when it is full
+    if(solver->trail_length == solver->trail_capacity)
+    {
+        solver->trail_capacity *= 2;
+        solver->trail = solver_realloc(solver,
+                solver->trail,
+                solver->trail_capacity * sizeof(KERNEL(trail_t)));
+    }
+
+    entry = &((KERNEL(trail_t)*) solver->trail)[solver->trail_length++];
+    entry->cell = cell;
+    entry->value = grid[cell];
+
+    if(pset_is_singleton(pset) && !pset_is_singleton(grid[cell]))
+    {
+        const int* peers = &solver->peers[cell * solver->peers_number];
+
+        --solver->unsolved;
+
+        for(int i = 0 ; i < solver->peers_number ; ++i)
+            if(pset_equals(grid[peers[i]], pset))
+                solver->contradiction = true;
+    }
+    else if(pset_equals(pset, pset_empty()))
+        solver->contradiction = true;
+
+    cardinality = pset_cardinality(grid[cell]);
+    new_cardinality = pset_cardinality(pset);
+    solver->stats.removed += cardinality - new_cardinality;
+
+    bucket_remove(solver, cell, cardinality);
+    bucket_insert(solver, cell, new_cardinality);
+    KERNEL(planes_update)(solver, cell, pset_xor(grid[cell], pset));
+
+    grid[cell] = pset;
+
+    for(int i = 0 ; i < 3 ; ++i)
+        subgrid_enqueue(solver, subgrids[i]);
+}
+
+static void
+KERNEL(trail_undo)(solver_t* solver, pset_t* grid, int trail_mark)
+{
+    while(solver->trail_length > trail_mark)
+    {
+        KERNEL(trail_t)* entry =
+            &((KERNEL(trail_t)*) solver->trail)[--solver->trail_length];
+        pset_t* cell = &grid[entry->cell];
+
+        if(pset_is_singleton(*cell) && !pset_is_singleton(entry->value))
+            ++solver->unsolved;
+
+        bucket_remove(solver, entry->cell, pset_cardinality(*cell));
+        bucket_insert(solver, entry->cell, pset_cardinality(entry->value));
+        KERNEL(planes_update)(solver,
+                entry->cell,
+                pset_xor(*cell, entry->value));
+
+        *cell = entry->value;
+    }
+
+    // The grid is back to a consistent fixpoint of the heuristics, but
+    // the queue may still hold the subgrids of an unconsistent branch
+    solver->contradiction = false;
+    queue_clear(solver);
+}
+
+static void
+KERNEL(planes_update)(solver_t* solver, int cell, pset_t changed)
+{
+    for(int i = 0 ; i < 3 ; ++i)
+    {
+        pset_t* planes =
+            &solver->planes[solver->cell_subgrids[3 * cell + i] * SIZE];
+        pset_t position =
+            ((pset_t) 1) << solver->cell_positions[3 * cell + i];
+
+        for(pset_t colors = changed ; colors != 0 ; colors &= colors - 1)
+            planes[pset_index(colors)] ^= position;
+    }
+}
+
+static void
+KERNEL(subgrid_gather)(pset_t* grid, const int* subgrid, pset_t* cells)
+{
+    for(int i = 0 ; i < SIZE ; ++i)
+        cells[i] = grid[subgrid[i]];
+}
+
+#if defined(SOLVER_VECTOR) && (SIZE >= VECTOR_MIN_SIZE)
+static void
+KERNEL(subgrid_gather_vectors)(pset_t* grid,
+        const int* subgrid,
+        pset_vector_t* vectors)
+{
+    // The lanes after the last cell are empty psets, which change none of
+    // the reductions of the heuristics
+    for(int i = 0 ; i < VECTORS ; ++i)
+        vectors[i] = vector_broadcast(pset_empty());
+
+    for(int i = 0 ; i < SIZE ; ++i)
+        vectors[i / VECTOR_LANES][i % VECTOR_LANES] = grid[subgrid[i]];
+}
+
+static bool
+KERNEL(cross_hatching)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    pset_vector_t vectors[VECTORS];
+    pset_vector_t singletons = vector_broadcast(pset_empty());
+    pset_vector_t pset_singletons;
+
+    KERNEL(subgrid_gather_vectors)(grid, subgrid, vectors);
+
+    // Cross-hatching heuristic
+    for(int i = 0 ; i < VECTORS ; ++i)
+        singletons |= vectors[i] & vector_singletons(vectors[i]);
+
+    pset_singletons = vector_broadcast(vector_or_lanes(singletons));
+
+    for(int i = 0 ; i < VECTORS ; ++i)
+    {
+        // The colors of the singletons are removed from the other cells
+        pset_vector_t removed =
+            pset_singletons & ~vector_singletons(vectors[i]);
+        pset_vector_t changed = vectors[i] & removed;
+
+        for(int j = 0 ; j < VECTOR_LANES ; ++j)
+            if(!pset_equals(changed[j], pset_empty()))
+            {
+                KERNEL(cell_assign)(solver,
+                        grid,
+                        subgrid[i * VECTOR_LANES + j],
+                        pset_substract(vectors[i][j], removed[j]));
+                result = false;
+            }
+    }
+
+    return result;
+}
+#else
+static bool
+KERNEL(cross_hatching)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    pset_t pset_tmp;
+    pset_t cells[SIZE];
+
+    KERNEL(subgrid_gather)(grid, subgrid, cells);
+
+    // Cross-hatching heuristic
+    pset_t pset_singletons = pset_empty();
+    for(int i = 0 ; i < SIZE ; ++i)
+        if(pset_is_singleton(cells[i]))
+            pset_singletons = pset_or(pset_singletons, cells[i]);
+
+    for(int i = 0 ; i < SIZE ; ++i)
+        if(!pset_is_singleton(cells[i]))
+        {
+            pset_tmp = pset_substract(cells[i], pset_singletons);
+            if(!pset_equals(pset_tmp, cells[i]))
+            {
+                KERNEL(cell_assign)(solver, grid, subgrid[i], pset_tmp);
+                cells[i] = pset_tmp;
+                result = false;
+            }
+        }
+
+    return result;
+}
+#endif
+
+static bool
+KERNEL(lone_number)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    pset_t pset_tmp;
+    // The digit planes of a subgrid are at the same offset in planes as
+    // its cells in subgrids
+    const pset_t* planes = &solver->planes[subgrid - solver->subgrids];
+
+    // Lone-number heuristic
+    // Colors which are possible in at least one cell of the subgrid
+    pset_t pset_colors = pset_empty();
+    // Colors which are possible in a single cell of the subgrid
+    pset_t pset_lone = pset_empty();
+    // Positions of the cells holding a lone color
+    pset_t positions = pset_empty();
+
+    for(int i = 0 ; i < SIZE ; ++i)
+    {
+        if(!pset_equals(planes[i], pset_empty()))
+            pset_colors = pset_or(pset_colors, ((pset_t) 1) << i);
+
+        if(pset_is_singleton(planes[i]))
+        {
+            pset_lone = pset_or(pset_lone, ((pset_t) 1) << i);
+            positions = pset_or(positions, planes[i]);
+        }
+    }
+
+    // A color which appears in no cell cannot be placed in the subgrid
+    if(!pset_equals(pset_colors, pset_full(SIZE)))
+    {
+        solver->contradiction = true;
+        return result;
+    }
+
+    // Only the cells holding a lone color are visited, in their order in
+    // the subgrid
+    for( ; positions != 0 ; positions &= positions - 1)
+    {
+        int i = pset_index(positions);
+
+        if(!pset_is_singleton(grid[subgrid[i]]))
+        {
+            pset_tmp = pset_and(grid[subgrid[i]], pset_lone);
+            if(!pset_equals(pset_tmp, grid[subgrid[i]]))
+            {
+                KERNEL(cell_assign)(solver, grid, subgrid[i], pset_tmp);
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+static bool
+KERNEL(n_possible)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    pset_t pset_tmp;
+    pset_t cells[SIZE];
+    pset_t subsets[SUBSETS];
+    int subsets_number;
+
+    KERNEL(subgrid_gather)(grid, subgrid, cells);
+
+    // N-possible heuristic
+    // When a n possible values are the only possible values on n cells
+    // of a subgrid, then those cells are the only place that can hold those
+    // values. So those n values can be removed from all other cells.
+    // (ref: http://sudokuassistant.co.uk/solving/solving-sudoku.htm)
+    // The n cells are either equal, or hold any part of the n values
+    subsets_number = KERNEL(naked_equal)(cells, subsets, 0);
+#if SIZE > 1
+    // The cells of the grids of size 1 have a single color
+    subsets_number = KERNEL(naked_union)(cells, subsets, subsets_number);
+#endif
+
+    for(int i = 0 ; i < subsets_number ; ++i)
+    {
+        int included = 0;
+
+        for(int j = 0 ; j < SIZE ; ++j)
+            if(pset_is_included(cells[j], subsets[i]))
+                ++included;
+
+        // More cells than values to hold
+        if(included > pset_cardinality(subsets[i]))
+        {
+            solver->contradiction = true;
+            return false;
+        }
+
+        for(int j = 0 ; j < SIZE ; ++j)
+            // Working only on unsolved cells and cells that are not
+            // in the subset
+            if((!pset_is_singleton(cells[j]))
+                    && (!pset_is_included(cells[j], subsets[i])))
+            {
+                pset_tmp = pset_substract(cells[j], subsets[i]);
+
+                if(!pset_equals(pset_tmp, cells[j]))
+                {
+                    KERNEL(cell_assign)(solver, grid, subgrid[j], pset_tmp);
+                    cells[j] = pset_tmp;
+                    result = false;
+                }
+            }
+    }
+
+    return result;
+}
+
+static int
+KERNEL(naked_equal)(const pset_t* cells, pset_t* subsets, int subsets_number)
+{
+    // Psets of the slots, the empty pset marking the free ones,
+    // and the number of cells holding them
+    pset_t keys[1 << TABLE_BITS] = {0};
+    int counts[1 << TABLE_BITS];
+    // Slot of each cell, -1 for the singletons and the empty cells
+    int slots[SIZE];
+
+    for(int i = 0 ; i < SIZE ; ++i)
+    {
+        int slot;
+
+        slots[i] = -1;
+        if(pset_equals(cells[i], pset_empty()) || pset_is_singleton(cells[i]))
+            continue;
+
+        // Linear probing
+        slot = pset_hash(cells[i], TABLE_BITS);
+        while(!pset_equals(keys[slot], pset_empty())
+                && !pset_equals(keys[slot], cells[i]))
+            slot = (slot + 1) & ((1 << TABLE_BITS) - 1);
+
+        if(pset_equals(keys[slot], pset_empty()))
+        {
+            keys[slot] = cells[i];
+            counts[slot] = 0;
+        }
+
+        ++counts[slot];
+        slots[i] = slot;
+    }
+
+    // The subsets are found in the order of their first cell, and their
+    // count is cleared so that they are found once
+    for(int i = 0 ; i < SIZE ; ++i)
+        if((slots[i] >= 0)
+                && (counts[slots[i]] >= pset_cardinality(cells[i])))
+        {
+            subsets_number = KERNEL(naked_add)(cells[i],
+                    subsets,
+                    subsets_number);
+            counts[slots[i]] = 0;
+        }
+
+    return subsets_number;
+}
+
+#if SIZE > 1
+static int
+KERNEL(naked_union)(const pset_t* cells, pset_t* subsets, int subsets_number)
+{
+    // Cells which can be part of a subset of 4 cells
+    pset_t candidates[SIZE];
+    int candidates_number = 0;
+
+    for(int i = 0 ; i < SIZE ; ++i)
+        if(!pset_is_singleton(cells[i]) && pset_at_most(cells[i], 4))
+            candidates[candidates_number++] = cells[i];
+
+    // The cells are added one by one in the order of the subgrid, and a
+    // union of more than 4 colors is not extended
+    for(int a = 0 ; a < candidates_number ; ++a)
+        for(int b = a + 1 ; b < candidates_number ; ++b)
+        {
+            pset_t union_2 = pset_or(candidates[a], candidates[b]);
+
+            if(!pset_at_most(union_2, 4))
+                continue;
+            if(pset_at_most(union_2, 2))
+                subsets_number = KERNEL(naked_add)(union_2,
+                        subsets,
+                        subsets_number);
+
+            for(int c = b + 1 ; c < candidates_number ; ++c)
+            {
+                pset_t union_3 = pset_or(union_2, candidates[c]);
+
+                if(!pset_at_most(union_3, 4))
+                    continue;
+                if(pset_at_most(union_3, 3))
+                    subsets_number = KERNEL(naked_add)(union_3,
+                            subsets,
+                            subsets_number);
+
+                for(int d = c + 1 ; d < candidates_number ; ++d)
+                    if(pset_at_most(pset_or(union_3, candidates[d]), 4))
+                        subsets_number = KERNEL(naked_add)(
+                                pset_or(union_3, candidates[d]),
+                                subsets,
+                                subsets_number);
+            }
+        }
+
+    return subsets_number;
+}
+#endif
+
+static int
+KERNEL(naked_add)(pset_t subset, pset_t* subsets, int subsets_number)
+{
+    if(subsets_number == SUBSETS)
+        return subsets_number;
+
+    for(int i = 0 ; i < subsets_number ; ++i)
+        if(pset_equals(subsets[i], subset))
+            return subsets_number;
+
+    subsets[subsets_number] = subset;
+    return subsets_number + 1;
+}
+
+static bool
+KERNEL(intersections)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    int unit = (subgrid - solver->subgrids) / SIZE;
+    const pset_t* planes = &solver->planes[unit * SIZE];
+    // Positions of the first row of a block, which are also the positions
+    // of the first block of a row or a column, and of the first column of
+    // a block
+    pset_t row_mask = pset_full(BLOCK_SIZE);
+    pset_t column_mask = pset_empty();
+
+    for(int i = 0 ; i < BLOCK_SIZE ; ++i)
+        column_mask = pset_or(column_mask, ((pset_t) 1) << (i * BLOCK_SIZE));
+
+    // Intersection heuristic
+    // When the possible cells of a color in a subgrid are all in its
+    // intersection with another subgrid, then the color is placed in the
+    // intersection, and can be removed from the other cells of the other
+    // subgrid. A block gives the pointing pairs and triples of its rows and
+    // columns, and a row or a column the box-line reduction of its blocks.
+    for(int color = 0 ; (color < SIZE) && !solver->contradiction ; ++color)
+    {
+        pset_t positions = planes[color];
+        int first;
+        // Other subgrid, and positions of the intersection in it
+        int other = -1;
+        pset_t kept = pset_empty();
+        pset_t removed;
+
+        // A single position is left to lone_number()
+        if(pset_equals(positions, pset_empty())
+                || pset_is_singleton(positions))
+            continue;
+
+        first = pset_index(positions);
+        if(unit < SIZE)
+        {
+            // Row x, whose positions are the columns
+            int block = first / BLOCK_SIZE;
+
+            if(pset_is_included(positions, row_mask << (block * BLOCK_SIZE)))
+            {
+                other = 2 * SIZE + (unit / BLOCK_SIZE) * BLOCK_SIZE + block;
+                kept = row_mask << ((unit % BLOCK_SIZE) * BLOCK_SIZE);
+            }
+        }
+        else if(unit < 2 * SIZE)
+        {
+            // Column y, whose positions are the rows
+            int y = unit - SIZE;
+            int block = first / BLOCK_SIZE;
+
+            if(pset_is_included(positions, row_mask << (block * BLOCK_SIZE)))
+            {
+                other = 2 * SIZE + block * BLOCK_SIZE + y / BLOCK_SIZE;
+                kept = column_mask << (y % BLOCK_SIZE);
+            }
+        }
+        else
+        {
+            // Block, whose positions are (x % BLOCK_SIZE) * BLOCK_SIZE
+            // + y % BLOCK_SIZE
+            int block = unit - 2 * SIZE;
+            int row = first / BLOCK_SIZE;
+            int column = first % BLOCK_SIZE;
+
+            if(pset_is_included(positions, row_mask << (row * BLOCK_SIZE)))
+            {
+                other = (block / BLOCK_SIZE) * BLOCK_SIZE + row;
+                kept = row_mask << ((block % BLOCK_SIZE) * BLOCK_SIZE);
+            }
+            else if(pset_is_included(positions, column_mask << column))
+            {
+                other = SIZE + (block % BLOCK_SIZE) * BLOCK_SIZE + column;
+                kept = row_mask << ((block / BLOCK_SIZE) * BLOCK_SIZE);
+            }
+        }
+
+        if(other < 0)
+            continue;
+
+        removed = pset_substract(solver->planes[other * SIZE + color], kept);
+        for( ; removed != 0 ; removed &= removed - 1)
+        {
+            int cell = solver->subgrids[other * SIZE + pset_index(removed)];
+
+            KERNEL(cell_assign)(solver,
+                    grid,
+                    cell,
+                    pset_substract(grid[cell], ((pset_t) 1) << color));
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+static bool
+KERNEL(hidden_subsets)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    pset_t pset_tmp;
+    const pset_t* planes = &solver->planes[subgrid - solver->subgrids];
+    pset_t subsets[SUBSETS];
+    int subsets_number = 0;
+
+    // Hidden subsets heuristic
+    // When n colors are only possible in the same n cells of a subgrid,
+    // then those cells can only hold those colors. The positions of the
+    // colors are to the colors what the colors of the cells are to the
+    // cells in n_possible(), so the subsets are the naked subsets of the
+    // digit planes, which are searched before the cells are modified.
+#if SIZE > 1
+    subsets_number = KERNEL(naked_union)(planes, subsets, 0);
+#endif
+
+    for(int i = 0 ; i < subsets_number ; ++i)
+    {
+        pset_t colors = pset_empty();
+
+        for(int color = 0 ; color < SIZE ; ++color)
+            if(!pset_equals(planes[color], pset_empty())
+                    && pset_is_included(planes[color], subsets[i]))
+                colors = pset_or(colors, ((pset_t) 1) << color);
+
+        // More colors than cells to hold them
+        if(pset_cardinality(colors) > pset_cardinality(subsets[i]))
+        {
+            solver->contradiction = true;
+            return false;
+        }
+
+        for(pset_t cells = subsets[i] ; cells != 0 ; cells &= cells - 1)
+        {
+            int cell = subgrid[pset_index(cells)];
+
+            pset_tmp = pset_and(grid[cell], colors);
+            if(!pset_equals(pset_tmp, grid[cell]))
+            {
+                KERNEL(cell_assign)(solver, grid, cell, pset_tmp);
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+static bool
+KERNEL(x_wing)(solver_t* solver, pset_t* grid, const int* subgrid)
+{
+    bool result = true;
+    int unit = (subgrid - solver->subgrids) / SIZE;
+    // The rows for a row, the columns for a column, and the subgrids
+    // crossing them
+    int lines = (unit < SIZE) ? 0 : SIZE;
+    int crosses = SIZE - lines;
+
+    // The blocks have no X-wing
+    if(unit >= 2 * SIZE)
+        return result;
+
+    // X-wing heuristic
+    // When the possible cells of a color in two rows are in the same two
+    // columns, then the color is placed in those columns by the two rows,
+    // and can be removed from the other cells of the columns. The same goes
+    // for two columns and their rows.
+    for(int color = 0 ; (color < SIZE) && !solver->contradiction ; ++color)
+    {
+        pset_t positions = solver->planes[unit * SIZE + color];
+        int line = -1;
+
+        if(pset_is_singleton(positions) || !pset_at_most(positions, 2))
+            continue;
+
+        for(int i = lines ; i < lines + SIZE ; ++i)
+        {
+            pset_t other = solver->planes[i * SIZE + color];
+
+            if((i != unit)
+                    && !pset_equals(other, pset_empty())
+                    && pset_is_included(other, positions))
+            {
+                line = i;
+                break;
+            }
+        }
+
+        if(line < 0)
+            continue;
+
+        for(pset_t cross = positions ; cross != 0 ; cross &= cross - 1)
+        {
+            int other = crosses + pset_index(cross);
+            pset_t removed = pset_substract(
+                    solver->planes[other * SIZE + color],
+                    pset_or(((pset_t) 1) << (unit - lines),
+                        ((pset_t) 1) << (line - lines)));
+
+            for( ; removed != 0 ; removed &= removed - 1)
+            {
+                int cell = solver->subgrids[other * SIZE
+                    + pset_index(removed)];
+
+                KERNEL(cell_assign)(solver,
+                        grid,
+                        cell,
+                        pset_substract(grid[cell], ((pset_t) 1) << color));
+                result = false;
+            }
+        }
+    }
+
+    return result;
+}
+
+static bool
+KERNEL(subgrid_consistency)(solver_t* solver,
+        pset_t* grid,
+        const int* subgrid)
+{
+    bool result = true;
+
+    (void)solver;
+
+    // Check that each color appears at least once
+    pset_t pset_colors = pset_empty();
+    for(int i = 0 ; i < SIZE ; ++i)
+        pset_colors = pset_or(grid[subgrid[i]], pset_colors);
+    result = result && pset_equals(pset_colors, pset_full(SIZE));
+
+    // Check that there are not two singletons of the same color
+    pset_t pset_singletons = pset_empty();
+    for(int i = 0 ; (i < SIZE) && result ; ++i)
+    {
+        if(pset_is_singleton(grid[subgrid[i]]))
+        {
+            if(pset_is_included(grid[subgrid[i]], pset_singletons))
+                result = false;
+            else
+                pset_singletons = pset_or(grid[subgrid[i]], pset_singletons);
+        }
+    }
+
+    // Check that there is no empty cell
+    for(int i = 0 ; (i < SIZE) && result ; ++i)
+        result = result && !pset_equals(grid[subgrid[i]], pset_empty());
+
+    return result;
+}
+
+#undef VECTORS
+#undef TABLE_BITS
+#undef BLOCK_SIZE
+#undef SUBSETS
+#undef CELL
+#undef KERNEL_CONCAT
+#undef KERNEL_NAME
+#undef KERNEL
+#undef SIZE
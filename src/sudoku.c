@@ -1,80 +1,222 @@
+#include <errno.h>
 #include <math.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
+#include "pool.h"
+#include "solver.h"
 #include "sudoku.h"
 
-static pset_t** grid_alloc(void);
-
-static void grid_free(pset_t**);
-
-static pset_t** grid_copy(pset_t**);
-
-static pset_t** grid_parser(FILE*);
-
-// Generate a grid of size grid_size
-static pset_t** grid_generate(bool);
-
-static bool check_input_char(char);
-
-static bool subgrid_map(pset_t**, bool (*func)(pset_t*[]));
-
-static void grid_print(pset_t**);
-
-// Print a grid solved to have readable output format
-static void grid_print_solved(pset_t**);
-
-#ifdef DEBUG
-static bool subgrid_print(pset_t*[]);
-#endif
-
-// Search for a solution
-// If the strict mode is set, then it will search for 2 solutions.
-// If 2 solutions are found, it returns 2
-// Else, it returns the number of solutions found (0 or 1)
-// If the strict mode is not set, it searches the first solution.
-// If the generate mode is set, the backtracking makes random choices
-// Parameter : the grid to solve
-// Return : return a number of solutions
-static int grid_solver(pset_t**);
-
-// Return : SOLVED if the grid has been solved
-//          CONSISTENT if it has not been solved but still consistent
-//          INCONSISTENT if not solved and unconsistent
-static int grid_heuristics(pset_t**);
-
-// Apply heuristics to the subgrid
-// Return : true if the subgrid has not been modified (fixpoint reached)
-//          false otherwise
-static bool subgrid_heuristics(pset_t*[]);
-
-static bool cross_hatching(pset_t*[]);
-
-static bool lone_number(pset_t*[]);
-
-static bool n_possible(pset_t*[]);
-
-static int grid_choice(pset_t**);
-
-static bool grid_consistency(pset_t**);
-
-static bool subgrid_consistency(pset_t*[]);
-
-// Return : count of occurencies of a given pset
-static int subgrid_count(pset_t*[], pset_t);
-
-static bool grid_solved(pset_t**);
-
-// Check if the length of the grid is a correct length
-static bool grid_valid_size(int);
-
-// Write the string on the error stream then exit
-static void grid_error(const char*);
+// Grid of a batch, solved by a worker of the pool
+typedef struct job
+{
+    struct batch* batch;
+    pset_t* grid;
+    unsigned short grid_size;
+    // Number of solutions found by the solver
+    int solutions;
+    // Verbose output of the solver, printed along with the result
+    char* trace;
+    size_t trace_size;
+    bool done;
+} job_t;
+
+// Buffered reader of a stream, which hands out its lines
+// A regular file is mapped in memory, and its lines are handed out in place
+typedef struct
+{
+    int fd;
+    char* buffer;
+    size_t capacity;
+    // Bytes read from the stream and not handed out yet
+    size_t start, end;
+    bool end_of_file;
+    // The buffer is the mapping of the whole file
+    bool mapped;
+    // The buffer belongs to an other reader, of which it is a chunk
+    bool borrowed;
+    // The stream holds grids of the binary format
+    bool binary;
+    // Number of lines handed out, from the start of the stream
+    int line;
+} reader_t;
+
+// Chunk of a mapped file, whose grids are parsed, solved and printed
+// into a buffer by a worker of the pool
+typedef struct chunk
+{
+    struct batch* batch;
+    reader_t reader;
+    // Grids of the chunk and, if they are not written to the standard
+    // output, the messages printed along with them
+    char* output;
+    size_t output_size;
+    char* messages;
+    size_t messages_size;
+    // Number of grids of the chunk
+    unsigned long grids;
+    // Grid being parsed and solved
+    pset_t* grid;
+    // An error stops the chunk, its message is printed after the grids
+    // which precede it
+    char error[256];
+    jmp_buf error_jump;
+    bool done;
+} chunk_t;
+
+// Batch of grids solved by a pool of workers
+// The grids are kept in a ring of jobs, so they can be printed in the
+// order they have been read while the next ones are being solved
+// The chunks of mapped files go through a ring of their own
+typedef struct batch
+{
+    pool_t* pool;
+    // Context of each worker of the pool
+    solver_t* solvers;
+    job_t* jobs;
+    int jobs_number;
+    // Number of grids read and number of grids printed
+    int read, printed;
+    chunk_t* chunks;
+    int chunks_number;
+    // Number of chunks submitted and number of chunks printed
+    int chunks_read, chunks_printed;
+    // Size of the chunks of the mapped file being read
+    size_t chunk_size;
+    // Number of grids printed, by the jobs and by the chunks
+    unsigned long grids_printed;
+    pthread_mutex_t lock;
+    // Signaled when a job or a chunk is done
+    pthread_cond_t done;
+} batch_t;
+
+// Class of the characters of a grid file
+enum
+{
+    CHAR_CELL = 0,
+    CHAR_BLANK,
+    CHAR_COMMENT
+};
+
+static const char char_classes[256] = {
+    [' '] = CHAR_BLANK,
+    ['\t'] = CHAR_BLANK,
+    ['#'] = CHAR_COMMENT};
+
+// Start reading a stream
+static void reader_init(reader_t*, FILE*);
+
+static void reader_destroy(reader_t*);
+
+// Return : the next line of the stream, without its '\n', which stays
+//          valid until the next call, NULL at the end of the stream
+// Parameter : the length of the line
+static char* reader_line(reader_t*, size_t*);
+
+// Return : the next bytes of the stream, which stay valid until the next
+//          call, NULL at the end of the stream
+// Parameter : the number of bytes
+static unsigned char* reader_bytes(reader_t*, size_t);
+
+// Read more of the stream into the buffer, keeping the bytes not handed
+// out yet, and making room for them if they fill the buffer
+static void reader_fill(reader_t*);
+
+// Hand out the next chunk of a mapped file, as a reader of its own
+// A chunk is about the given size, and is cut right after a line holding a
+// whole grid (an 81 cells line for a 9x9 grid). If there is no such line
+// after the given size, the chunk goes on to the end of the file.
+// The chunks of a binary file are cut between two records.
+// Return : false if the whole file has been handed out
+static bool reader_chunk(reader_t*, reader_t*, size_t);
+
+// Return : true if the line holds a whole grid written on one line
+static bool line_is_grid(const char*, size_t);
+
+// Parse the next grid of a stream
+// A grid ends as soon as its last line has been read, so several grids can
+// follow each other in the same stream (empty lines are ignored).
+// A first line holding the square of a valid size of cells (81 for a 9x9
+// grid) is a whole grid written on one line, where '.' and '0' can also be
+// used for an empty cell.
+// A line of 16 cells is the first row of a 16x16 grid, unless it holds a
+// '.' or a '0', which a row cannot hold: a 4x4 grid written on one line
+// needs at least one empty cell written so.
+// Parameter : the reader of the stream
+// Parameter : the grid to fill, it is reused from a call to another
+//             and only reallocated if the size of the grid changes
+// Return : false if there is no more grid in the stream, true otherwise
+static bool grid_parser(solver_t*, reader_t*, pset_t**);
+
+// Read the next grid of a stream of the binary format
+// Parameter : the reader of the stream
+// Parameter : the grid to fill, as grid_parser()
+// Return : false if there is no more grid in the stream, true otherwise
+static bool grid_parser_binary(solver_t*, reader_t*, pset_t**);
+
+// Read the next grid of a stream, whatever its format
+static bool grid_read(solver_t*, reader_t*, pset_t**);
+
+static bool check_input_char(solver_t*, char);
+
+// Start the workers of a batch
+// Parameter : the context whose options are given to the workers
+// Parameter : the number of workers
+static void batch_init(batch_t*, solver_t*, int);
+
+// Read the next grid of a stream and submit it to the workers
+// Return : false if there is no more grid in the stream
+static bool batch_read(batch_t*, solver_t*, reader_t*);
+
+// Wait for the oldest grid not printed yet to be solved, then print it
+static void batch_print(batch_t*, solver_t*);
+
+// Print the remaining grids then stop the workers
+static void batch_destroy(batch_t*, solver_t*);
+
+// Choose the size of the chunks of a mapped file, so that each worker
+// gets at least two of them
+// Return : false if the file is cut in no more chunks than workers, whose
+//          grids are better read one by one, as the other streams
+static bool batch_chunk_file(batch_t*, reader_t*);
+
+// Submit the next chunk of a mapped file to the workers
+// Return : false if the whole file has been submitted
+static bool batch_read_chunk(batch_t*, solver_t*, reader_t*);
+
+// Wait for the oldest chunk not printed yet, then print its grids
+static void batch_print_chunk(batch_t*, solver_t*);
+
+// Print every grid and chunk read so far
+static void batch_flush(batch_t*, solver_t*);
+
+// Parse, solve and print the grids of a chunk, run by a worker of the pool
+static void chunk_run(void*, int);
+
+// Print the result of the solver and the grid
+// Parameter : the stream of the messages, the grid being printed on the
+//             output stream of the solver
+// Parameter : the grid
+// Parameter : the number of solutions found
+static void grid_report(solver_t*, FILE*, pset_t*, int);
+
+// Solve the grid of a job, run by a worker of the pool
+static void job_run(void*, int);
+
+// Print the statistics of the solvers on the error stream, with the time
+// elapsed since the given instant, then the counters of each heuristic
+// applied
+static void stats_print(solver_stats_t*, struct timespec*);
 
 // Error message for too many or too few lines
 static void grid_error_line_number(void);
@@ -91,23 +233,68 @@ static void usage(int);
 static void version(void);
 
 static char* soft_name = NULL;
-static FILE* output_stream = NULL;
-static bool verbose, generate, strict;
+// Name of the file being processed, for the error messages
+static const char* input_name = NULL;
 
-// Size of the current grid
-static unsigned short grid_size = 0;
+// Batch printed before exiting on an error of the main thread, so the
+// grids solved up to the error are not lost
+static batch_t* error_batch = NULL;
+static solver_t* error_solver = NULL;
+static pthread_t main_thread;
 
-static const int heuristics_number = 3;
-static bool (*heuristics[])(pset_t*[]) = {
-    cross_hatching,
-    lone_number,
-    n_possible};
+// Chunk run by the calling thread, NULL outside of the chunks
+static pthread_key_t chunk_key;
 
 int
 main(int argc, char* argv[])
 {
     int optc;
+    int jobs = pool_cpu_count();
     FILE* grid_file = NULL;
+    solver_t solver = {
+        .grid_size = 0,
+        .verbose = false,
+        .generate = false,
+        .format = FORMAT_TEXT,
+        .engine = ENGINE_HEURISTICS,
+        .strict = false,
+        .output_stream = stdout,
+        .seed = 0,
+        .pipeline = NULL,
+        .profile = false,
+        .split_depth = 0,
+        .search = NULL,
+        .buffers_size = 0,
+        .trail = NULL,
+        .trail_length = 0,
+        .trail_capacity = 0,
+        .solution = NULL,
+        .solution_found = false,
+        .subgrids = NULL,
+        .peers = NULL,
+        .peers_number = 0,
+        .cell_subgrids = NULL,
+        .cell_positions = NULL,
+        .planes = NULL,
+        .queue = NULL,
+        .queue_head = 0,
+        .queue_length = 0,
+        .queued = NULL,
+        .stale = NULL,
+        .contradiction = false,
+        .unsolved = 0,
+        .buckets = NULL,
+        .bucket_next = NULL,
+        .bucket_prev = NULL,
+        .kernels = NULL,
+        .print_buffer = NULL,
+        .print_capacity = 0,
+        .branches = NULL,
+        .dlx = NULL,
+        .stats = {0}};
+    bool stats = false;
+    pipeline_t pipeline;
+    struct timespec start;
     struct option long_opts[] = {
         {"output", required_argument, NULL, 'o'},
         {"verbose", no_argument, NULL, 'v'},
@@ -115,30 +302,36 @@ main(int argc, char* argv[])
         {"help", no_argument, NULL, 'h'},
         {"generate", optional_argument, NULL, 'g'},
         {"strict", no_argument, NULL, 's'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"parallel", optional_argument, NULL, 'p'},
+        {"stats", no_argument, NULL, 'S'},
+        {"compact", no_argument, NULL, 'c'},
+        {"binary", no_argument, NULL, 'b'},
+        {"dlx", no_argument, NULL, 'x'},
+        {"heuristics", required_argument, NULL, 'H'},
         {NULL, 0, NULL, 0}};
 
     soft_name = argv[0];
-    output_stream= stdout;
-    verbose = false;
-    generate = false;
-    strict = false;
+    main_thread = pthread_self();
+    pthread_key_create(&chunk_key, NULL);
 
     // Scan the options
-    while((optc = getopt_long(argc, argv, "o:vVhg::s", long_opts, NULL)) != -1)
+    while((optc = getopt_long(argc, argv,
+                    "o:vVhg::sj:p::ScbxH:", long_opts, NULL)) != -1)
     {
         switch(optc)
         {
             case 'o': // Set the output stream for printing the result
-                output_stream = fopen(optarg, "w");
+                solver.output_stream = fopen(optarg, "w");
 
-                if(!output_stream)
+                if(!solver.output_stream)
                 {
                     perror("Output stream");
                     exit(EXIT_FAILURE);
                 }
                 break;
             case 'v': // Set the verbose mode on
-                verbose = true;
+                solver.verbose = true;
                 break;
             case 'V': // Show the version of the software and exit
                 version();
@@ -148,870 +341,1085 @@ main(int argc, char* argv[])
                 break;
             case 'g': // Generate a grid of a size given (default : 9)
                 if(optarg == NULL)
-                    grid_size = 9;
+                    solver.grid_size = 9;
                 else
                 {
-                    grid_size = atoi(optarg);
-                    if(!grid_valid_size(grid_size))
+                    solver.grid_size = atoi(optarg);
+                    if(!grid_valid_size(solver.grid_size))
                         usage(EXIT_FAILURE);
                 }
 
-                generate = true;
+                solver.generate = true;
                 break;
             case 's':
-                strict = true;
+                solver.strict = true;
+                break;
+            case 'j': // Set the number of grids solved at the same time
+                jobs = atoi(optarg);
+                if((jobs < 1) || (jobs > MAX_JOBS))
+                    usage(EXIT_FAILURE);
+                break;
+            case 'p': // Split the search of each grid (default depth : 3)
+                if(optarg == NULL)
+                    solver.split_depth = 3;
+                else
+                {
+                    solver.split_depth = atoi(optarg);
+                    if(solver.split_depth < 1)
+                        usage(EXIT_FAILURE);
+                }
+                break;
+            case 'S': // Print the statistics of the solvers at the end
+                stats = true;
+                solver.profile = true;
+                break;
+            case 'c': // Print each grid on one line
+                solver.format = FORMAT_COMPACT;
+                break;
+            case 'b': // Write the grids in the binary format
+                solver.format = FORMAT_BINARY;
+                break;
+            case 'x': // Solve the grids with the dancing links
+                solver.engine = ENGINE_DLX;
+                break;
+            case 'H': // Choose the heuristics applied to the subgrids
+                if(!pipeline_parse(&pipeline, optarg))
+                    usage(EXIT_FAILURE);
+
+                solver.pipeline = &pipeline;
                 break;
             default: // If the option is invaild, show an error and exit
                 usage(EXIT_FAILURE);
         }
     }
 
+    if(jobs > MAX_JOBS)
+        jobs = MAX_JOBS;
+
     // Initialize the seed for the random number generator
-    srand(time(NULL) + getpid());
+    solver.seed = time(NULL) + getpid();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
 
-    if(generate)
+    if(solver.format == FORMAT_BINARY)
+    {
+        // The verbose output would be mixed with the records
+        if(solver.verbose)
+            usage(EXIT_FAILURE);
+
+        fwrite(BINARY_MAGIC, 1, BINARY_MAGIC_SIZE, solver.output_stream);
+    }
+
+    if(solver.generate)
     {
         // Generate a random grid
-        pset_t** grid = grid_generate(strict);
+        pset_t* grid = grid_generate(&solver);
 
-        grid_print_solved(grid);
+        if(solver.format == FORMAT_BINARY)
+            grid_write_binary(&solver, grid, CONSISTENT);
+        else
+            grid_print_solved(&solver, grid);
 
-        grid_free(grid);
+        grid_free(&solver, grid);
     }
     else
     {
         // This option is not a valid option in this mode
-        if(strict)
+        if(solver.strict)
             usage(EXIT_FAILURE);
 
         // Make sure that the software is called with at least one file
         if(optind == argc)
             usage(EXIT_FAILURE);
 
-        grid_file = fopen(argv[optind], "r");
-        if(!grid_file)
-        {
-            perror(argv[optind]);
-            exit(EXIT_FAILURE);
-        }
+        batch_t batch;
 
-        pset_t** grid = grid_parser(grid_file);
+        batch_init(&batch, &solver, jobs);
+        error_batch = &batch;
+        error_solver = &solver;
 
-        if(grid_solver(grid) >= 1)
+        // Solve every grid of every file, in the order they are given
+        for(int i = optind ; i < argc ; ++i)
         {
-            printf("The grid has been solved!\n");
+            bool grid_found = false;
+            reader_t reader;
 
-            grid_print_solved(grid);
-        }
-        else
-        {
-            printf("The grid hasn't been solved!\n");
-            printf("The grid isn't consistent!\n");
+            input_name = argv[i];
+
+            if(strcmp(argv[i], "-") == 0)
+                grid_file = stdin;
+            else
+            {
+                grid_file = fopen(argv[i], "r");
+                if(!grid_file)
+                {
+                    batch_flush(&batch, &solver);
+                    perror(argv[i]);
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            reader_init(&reader, grid_file);
+
+            // The grids of a mapped file are parsed by the workers, a chunk
+            // each, unless every worker takes part in the search of a grid
+            // or the file cannot be cut in enough chunks
+            if(reader.mapped && (solver.split_depth == 0)
+                    && batch_chunk_file(&batch, &reader))
+            {
+                unsigned long grids;
+
+                batch_flush(&batch, &solver);
+                grids = solver.stats.grids;
+
+                while(batch_read_chunk(&batch, &solver, &reader))
+                    continue;
+
+                batch_flush(&batch, &solver);
+                grid_found = (solver.stats.grids > grids);
+            }
+            else
+                while(batch_read(&batch, &solver, &reader))
+                    grid_found = true;
+
+            if(!grid_found)
+                grid_error("no grid found in the file");
+
+            reader_destroy(&reader);
 
-            grid_print(grid);
+            if(grid_file != stdin)
+                fclose(grid_file);
         }
 
-        grid_free(grid);
-        fclose(grid_file);
+        input_name = NULL;
+        error_batch = NULL;
+
+        batch_destroy(&batch, &solver);
     }
 
-    if(output_stream != stdout)
-        fclose(output_stream);
+    if(stats)
+        stats_print(&solver.stats, &start);
+
+    solver_free(&solver);
+
+    if(solver.output_stream != stdout)
+        fclose(solver.output_stream);
 
     return EXIT_SUCCESS;
 }
 
-static pset_t**
-grid_alloc(void)
+static void
+batch_init(batch_t* batch, solver_t* solver, int workers)
 {
-    pset_t** result;
+    batch->pool = pool_create(workers);
+    batch->read = batch->printed = 0;
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->done, NULL);
 
-    result = calloc(grid_size, sizeof(pset_t*));
-    if(result == NULL)
+    batch->solvers = calloc(workers, sizeof(solver_t));
+    if(batch->solvers == NULL)
         grid_error("out of memory !");
 
-    for(int i = 0 ; i < grid_size ; ++i)
+    for(int i = 0 ; i < workers ; ++i)
     {
-        result[i] = calloc(grid_size, sizeof(pset_t));
-        if(result[i] == NULL)
-            grid_error("out of memory !");
+        batch->solvers[i] = *solver;
+        batch->solvers[i].seed = solver->seed + i + 1;
     }
 
-    return result;
-}
+    // Enough grids in the ring to keep every worker busy
+    batch->jobs_number = 16 * workers;
+    batch->jobs = calloc(batch->jobs_number, sizeof(job_t));
+    if(batch->jobs == NULL)
+        grid_error("out of memory !");
 
-static void
-grid_free(pset_t** grid)
-{
-    for(int i = 0 ; i < grid_size ; ++i)
-        free(grid[i]);
+    for(int i = 0 ; i < batch->jobs_number ; ++i)
+        batch->jobs[i].batch = batch;
+
+    // The output of a chunk is kept until it is printed, so there are
+    // only a few more chunks than workers
+    batch->chunks_number = 2 * workers;
+    batch->chunks = calloc(batch->chunks_number, sizeof(chunk_t));
+    if(batch->chunks == NULL)
+        grid_error("out of memory !");
+
+    for(int i = 0 ; i < batch->chunks_number ; ++i)
+        batch->chunks[i].batch = batch;
 
-    free(grid);
+    batch->chunks_read = batch->chunks_printed = 0;
+    batch->chunk_size = CHUNK_SIZE;
+    batch->grids_printed = 0;
 }
 
-static pset_t**
-grid_copy(pset_t** grid)
+static bool
+batch_read(batch_t* batch, solver_t* solver, reader_t* reader)
 {
-    pset_t** result;
+    job_t* job = &batch->jobs[batch->read % batch->jobs_number];
+
+    // The job of the ring can only be reused once it has been printed
+    if((batch->read - batch->printed) == batch->jobs_number)
+        batch_print(batch, solver);
+
+    // The parser reuses the grid of the job
+    solver->grid_size = job->grid_size;
+    if(!grid_read(solver, reader, &job->grid))
+        return false;
+
+    job->grid_size = solver->grid_size;
+    job->done = false;
+    ++batch->read;
+    ++solver->stats.grids;
+
+    // Every worker takes part in the search of this grid, which is then
+    // printed before reading the next one
+    // (the verbose output of a parallel search would be unreadable, and
+    // the dancing links do not split their search)
+    if((solver->split_depth > 0) && !solver->verbose
+            && (solver->engine == ENGINE_HEURISTICS))
+    {
+        for(int i = 0 ; i < pool_workers(batch->pool) ; ++i)
+            batch->solvers[i].grid_size = job->grid_size;
 
-    result = grid_alloc();
+        job->solutions = grid_solver_parallel(batch->solvers,
+                batch->pool,
+                job->grid);
+        job->done = true;
 
-    for(int i = 0 ; i < grid_size ; ++i)
-        for(int j = 0 ; j < grid_size ; ++j)
-            result[i][j] = grid[i][j];
+        batch_print(batch, solver);
+    }
+    else
+        pool_submit(batch->pool, job_run, job);
 
-    return result;
+    return true;
 }
 
-static pset_t**
-grid_parser(FILE* file)
+static void
+batch_print(batch_t* batch, solver_t* solver)
 {
-    pset_t** result = NULL;
-    char current_char;
-    char first_line[MAX_COLORS];
-    int line, column;
+    job_t* job = &batch->jobs[batch->printed % batch->jobs_number];
 
-    // States of the parser
-    bool state_first_line = true;
-    bool state_empty_line = true;
-    bool state_commentary = false;
-    bool state_end_of_file = false;
+    pthread_mutex_lock(&batch->lock);
+    while(!job->done)
+        pthread_cond_wait(&batch->done, &batch->lock);
+    pthread_mutex_unlock(&batch->lock);
 
-    line = column = 0;
+    // Separate the grids from each other
+    if((batch->grids_printed > 0) && (solver->format == FORMAT_TEXT))
+        fprintf(solver->output_stream, "\n");
 
-    // Scanning the grid
-    while(!state_end_of_file)
+    if(job->trace != NULL)
     {
-        current_char = fgetc(file);
-        switch(current_char)
-        {
-            case ' ': // Filter out blank characters
-            case '\t':
-                break;
+        fwrite(job->trace, 1, job->trace_size, solver->output_stream);
+        free(job->trace);
+        job->trace = NULL;
+    }
 
-            case EOF: 
-                state_end_of_file = true;
-                // Process also the '\n'-case code because the last line can be
-                // ended with a EOF character without a '\n' character before.
-                // In case of the EOF following the '\n', the parser would be
-                // in an empty_line state so it would not do anything abnormal
-            case '\n':
-                if(!state_empty_line)
-                {
-                    // Special process for the first line
-                    if(state_first_line)
-                    {
-                        if(!grid_valid_size(column))
-                            grid_error_line(line + 1);
-
-                        grid_size = column;
-                        result = grid_alloc();
-
-                        for(int i = 0 ; i < column ; ++i)
-                        {
-                            // Check if it is valid content as it was not
-                            // checked on the first copy
-                            if(check_input_char(first_line[i]))
-                                if(first_line[i] == '_')
-                                    result[line][i] = pset_full(grid_size);
-                                else
-                                    result[line][i] = char2pset(first_line[i]);
-                            else
-                                grid_error_char(first_line[i], line + 1);
-                        }
-
-                        state_first_line = false;
-                    }
-
-                    if(column != grid_size)
-                        grid_error_line(line + 1);
-
-                    column = 0;
-                    ++line;
-                }
+    solver->grid_size = job->grid_size;
 
-                state_empty_line = true;
-                state_commentary = false;
+    grid_report(solver, stdout, job->grid, job->solutions);
 
-                break;
+    ++batch->printed;
+    ++batch->grids_printed;
+}
 
-            case '#': // Starting the commentary state
-                state_commentary = true;
-                break;
+static void
+grid_report(solver_t* solver, FILE* messages, pset_t* grid, int solutions)
+{
+    // The compact and binary formats only print the grid, its unsolved
+    // cells or its status tell that it has not been solved
+    if(solver->format == FORMAT_BINARY)
+        grid_write_binary(solver, grid, (solutions >= 1) ?
+                SOLVED : UNCONSISTENT);
+    else if(solver->format == FORMAT_COMPACT)
+        grid_print_solved(solver, grid);
+    else if(solutions >= 1)
+    {
+        fprintf(messages, "The grid has been solved!\n");
 
-            default:
-                // Handle the character only if it is not in a commentary
-                if(!state_commentary)
-                {
-                    state_empty_line = false;
-
-                    if(state_first_line)
-                        // On the first line, the content is copied
-                        // without checking the validity of the character
-                        // as can't tell the size of the grid yet.
-                        // Verifications are done when copying into the grid
-                        first_line[column] = current_char;
-                    else
-                    {
-                        if(column >= grid_size)
-                            grid_error_line(line + 1);
-
-                        if(line >= grid_size)
-                            grid_error_line_number();
-
-                        if(check_input_char(current_char))
-                            if(current_char == '_')
-                                result[line][column] = pset_full(grid_size);
-                            else
-                                result[line][column] = char2pset(current_char);
-                        else
-                            grid_error_char(current_char, line + 1);
-                    }
-
-                    ++column;
-                }
+        grid_print_solved(solver, grid);
+    }
+    else
+    {
+        fprintf(messages, "The grid hasn't been solved!\n");
+        fprintf(messages, "The grid isn't consistent!\n");
 
-                break;
-        }
+        grid_print(solver, grid);
     }
+}
 
-    if(result == NULL)
-        grid_error("no grid found in the file");
+static bool
+batch_chunk_file(batch_t* batch, reader_t* reader)
+{
+    int workers = pool_workers(batch->pool);
+    size_t start = reader->start;
+    int line = reader->line;
+    int chunks = 0;
+    reader_t chunk;
+
+    batch->chunk_size = (reader->end - reader->start) / (2 * workers);
+    if(batch->chunk_size > CHUNK_SIZE)
+        batch->chunk_size = CHUNK_SIZE;
+
+    // The file is cut until there are more chunks than workers, then
+    // handed out again from its start
+    while((chunks <= workers)
+            && reader_chunk(reader, &chunk, batch->chunk_size))
+        ++chunks;
+
+    reader->start = start;
+    reader->line = line;
+
+    return chunks > workers;
+}
 
-    if(line < grid_size)
-        grid_error_line_number();
+static bool
+batch_read_chunk(batch_t* batch, solver_t* solver, reader_t* reader)
+{
+    chunk_t* chunk = &batch->chunks[batch->chunks_read % batch->chunks_number];
 
-    return result;
+    // The chunk of the ring can only be reused once it has been printed
+    if((batch->chunks_read - batch->chunks_printed) == batch->chunks_number)
+        batch_print_chunk(batch, solver);
+
+    if(!reader_chunk(reader, &chunk->reader, batch->chunk_size))
+        return false;
+
+    chunk->grids = 0;
+    chunk->done = false;
+    ++batch->chunks_read;
+
+    pool_submit(batch->pool, chunk_run, chunk);
+
+    return true;
 }
 
-static pset_t**
-grid_generate(bool strict)
+static void
+batch_print_chunk(batch_t* batch, solver_t* solver)
 {
-    pset_t** result = grid_alloc();
-    int remove_limit, percent;
-    bool still_choices = true;
-    // Bidimentional array to check if a cell can be removed
-    bool checked_cells[grid_size][grid_size];
-    int removed_cells = 0;
-
-    // Fill up the grid with full pset
-    for(int i = 0 ; i < grid_size ; ++i)
-        for(int j = 0 ; j < grid_size ; ++j)
-            result[i][j] = pset_full(grid_size);
-
-    for(int i = 0 ; i < grid_size ; ++i)
-        for(int j = 0 ; j < grid_size ; ++j)
-            checked_cells[i][j] = false;
-
-    // Slove the grid, as the backtracking use random choices if
-    // it is in generate mode, it generates a randomly grid but
-    // consistent and solved
-    grid_solver(result);
-
-    // Compute the percentage of cells to remove
-    if(grid_size == 1)
-        percent = 100;
-    else
+    chunk_t* chunk =
+        &batch->chunks[batch->chunks_printed % batch->chunks_number];
+    char* output;
+    size_t output_size;
+
+    pthread_mutex_lock(&batch->lock);
+    while(!chunk->done)
+        pthread_cond_wait(&batch->done, &batch->lock);
+    pthread_mutex_unlock(&batch->lock);
+
+    output = chunk->output;
+    output_size = chunk->output_size;
+
+    // Every grid of the chunk is preceded by the separator of the grids,
+    // which is not printed before the first grid
+    if((batch->grids_printed == 0) && (output_size > 0)
+            && (solver->format == FORMAT_TEXT))
     {
-        if(grid_size <= 16)
-            percent = 40 + (rand() % 20);
-        else if(grid_size <= 49)
-            percent = 30 + (rand() % 10);
-        else
-            percent = 20 + (rand() % 5);
+        ++output;
+        --output_size;
     }
 
-    remove_limit = (grid_size * grid_size) * percent / 100;
+    if(chunk->messages != NULL)
+        fwrite(chunk->messages, 1, chunk->messages_size, stdout);
 
-    while((removed_cells < remove_limit) && still_choices)
-    {
-        // Choose a random coordinate
-        int x = rand() % grid_size;
-        int y = rand() % grid_size;
-
-        // If the random cell is already checked,
-        // move to the next cell, so it cannot have
-        // infinite loop in the case of bad random choices
-        while(checked_cells[x][y])
-        {
-            x = (x + 1) % grid_size;
-            if(x == 0)
-                y = (y + 1) % grid_size;
-        }
-
-        if(strict)
-        {
-            // Try to solve a copy with an unique solution
-            pset_t** result_tmp = grid_copy(result);
-            result_tmp[x][y] = pset_full(grid_size);
-
-            if(grid_solver(result_tmp) == 1)
-            {
-                // If it has an unique solution, then apply the choice
-                result[x][y] = pset_full(grid_size);
-                ++removed_cells;
-            }
+    fwrite(output, 1, output_size, solver->output_stream);
 
-            grid_free(result_tmp);
-        }
-        else
-        {
-            result[x][y] = pset_full(grid_size);
-            ++removed_cells;
-        }
+    free(chunk->output);
+    free(chunk->messages);
+    chunk->output = chunk->messages = NULL;
 
-        // The cell has been checked whatever is the result
-        // As if it had one solution it is set to full
-        // and if not, it is not necessary to re-check this cell
-        checked_cells[x][y] = true;
+    batch->grids_printed += chunk->grids;
+    solver->stats.grids += chunk->grids;
+    ++batch->chunks_printed;
 
-        for(int i = 0 ; i < grid_size ; ++i)
-            for(int j = 0 ; j < grid_size ; ++j)
-                still_choices = still_choices || !(checked_cells[i][j]);
+    // The chunks which follow the error are not printed
+    if(chunk->error[0] != '\0')
+    {
+        error_batch = NULL;
+        grid_error(chunk->error);
     }
-
-    return result;
 }
 
-static bool
-check_input_char(char c)
+static void
+batch_flush(batch_t* batch, solver_t* solver)
 {
-    bool result = false;
-
-    if(c == '_')
-        result = true;
-    else
-        for(int i = 0 ; i < grid_size ; ++i)
-        {
-            if(color_table[i] == c)
-            {
-                result = true;
-                break;
-            }
-        }
+    while(batch->printed < batch->read)
+        batch_print(batch, solver);
 
-    return result;
+    while(batch->chunks_printed < batch->chunks_read)
+        batch_print_chunk(batch, solver);
 }
 
-static bool
-subgrid_map(pset_t** grid, bool (*func)(pset_t* subgrid[]))
+static void
+chunk_run(void* arg, int worker)
 {
-    bool result = true;
-    bool func_result;
-    pset_t** subgrid;
-
-    subgrid = calloc(grid_size, sizeof(pset_t*));
-    if(subgrid == NULL)
+    chunk_t* chunk = arg;
+    solver_t* solver = &chunk->batch->solvers[worker];
+    FILE* output_stream = solver->output_stream;
+    FILE* messages;
+
+    solver->output_stream = open_memstream(&chunk->output,
+            &chunk->output_size);
+    if(solver->output_stream == NULL)
         grid_error("out of memory !");
 
-    // Scanning all rows
-    for(int i = 0 ; i < grid_size ; ++i)
+    // The messages go to the standard output, along with the grids
+    // unless they are written to an other file
+    if((output_stream == stdout) || (solver->format != FORMAT_TEXT))
+        messages = solver->output_stream;
+    else
     {
-        for(int j = 0 ; j < grid_size ; ++j)
-            subgrid[j] = &(grid[i][j]);
-
-        // The result of the function is computed apart as
-        // the and operator does not compute all the expression
-        // if one member is false
-        func_result = (*func)(subgrid);
-        result = result && func_result;
+        messages = open_memstream(&chunk->messages, &chunk->messages_size);
+        if(messages == NULL)
+            grid_error("out of memory !");
     }
 
-    // Scanning all columns
-    for(int j = 0 ; j < grid_size ; ++j)
-    { 
-        for(int i = 0 ; i < grid_size ; ++i)
-            subgrid[i] = &(grid[i][j]);
-
-        func_result = (*func)(subgrid);
-        result = result && func_result;
-    }
+    chunk->grid = NULL;
+    chunk->error[0] = '\0';
+    pthread_setspecific(chunk_key, chunk);
 
-    // Scanning all blocks
-    int block_size = (int)sqrt(grid_size);
-    int block_i, block_j;
-    int cell_i, cell_j;
-    for(int i = 0 ; i < block_size; ++i)
-    {
-        for(int j = 0 ; j < block_size ; ++j)
+    // The grids read before an error are still printed
+    if(setjmp(chunk->error_jump) == 0)
+        while(grid_read(solver, &chunk->reader, &chunk->grid))
         {
-            // Coordinates of the top left cell of the block
-            block_i = i * block_size;
-            block_j = j * block_size;
+            if(solver->format == FORMAT_TEXT)
+                fprintf(solver->output_stream, "\n");
 
-            for(int k = 0 ; k < grid_size ; ++k)
-            {
-                cell_i = block_i + (k / block_size);
-                cell_j = block_j + (k % block_size);
-                subgrid[k] = &(grid[cell_i][cell_j]);
-            }
+            grid_report(solver, messages, chunk->grid,
+                    grid_solver(solver, chunk->grid));
 
-            func_result = (*func)(subgrid);
-            result = result && func_result;
+            ++chunk->grids;
         }
-    }
 
-    free(subgrid);
+    pthread_setspecific(chunk_key, NULL);
 
-    return result;
+    if(messages != solver->output_stream)
+        fclose(messages);
+    fclose(solver->output_stream);
+    solver->output_stream = output_stream;
+
+    if(chunk->grid != NULL)
+        grid_free(solver, chunk->grid);
+
+    pthread_mutex_lock(&chunk->batch->lock);
+    chunk->done = true;
+    pthread_cond_broadcast(&chunk->batch->done);
+    pthread_mutex_unlock(&chunk->batch->lock);
 }
 
 static void
-grid_print(pset_t** grid)
+batch_destroy(batch_t* batch, solver_t* solver)
 {
-    char string[MAX_COLORS + 1];
-
-    for(int i = 0 ; i < grid_size ; ++i)
-    {
-        for(int j = 0 ; j < grid_size ; ++j)
-        {
-            pset2str(string, grid[i][j]);
-            fprintf(output_stream, "%*s", grid_size, string);
+    batch_flush(batch, solver);
 
-            if(j < (grid_size - 1))
-                fprintf(output_stream, " ");
-        }
+    int workers = pool_workers(batch->pool);
 
-        fprintf(output_stream, "\n");
-    }
-}
+    pool_destroy(batch->pool);
 
-static void
-grid_print_solved(pset_t** grid)
-{
-    if(generate && (grid_size == 1))
-        fprintf(output_stream, "_\n");
-    else
+    for(int i = 0 ; i < workers ; ++i)
     {
-        char string[MAX_COLORS + 1];
+        solver->stats.nodes += batch->solvers[i].stats.nodes;
+        solver->stats.allocations += batch->solvers[i].stats.allocations;
+        solver->stats.removed += batch->solvers[i].stats.removed;
 
-        for(int i = 0 ; i < grid_size ; ++i)
+        for(int j = 0 ; j < HEURISTICS_NUMBER ; ++j)
         {
-            for(int j = 0 ; j < grid_size ; ++j)
-            {
+            heuristic_stats_t* heuristic = &solver->stats.heuristics[j];
+            heuristic_stats_t* worker = &batch->solvers[i].stats.heuristics[j];
 
-                if(pset_is_singleton(grid[i][j]))
-                {
-                    pset2str(string, grid[i][j]);
-                    fprintf(output_stream, "%s", string);
-                }
-                else
-                    fprintf(output_stream, "_");
+            heuristic->calls += worker->calls;
+            heuristic->removed += worker->removed;
+            heuristic->time += worker->time;
+        }
 
-                if(j < (grid_size - 1))
-                    fprintf(output_stream, " ");
-            }
+        solver_free(&batch->solvers[i]);
+    }
 
-            fprintf(output_stream, "\n");
+    for(int i = 0 ; i < batch->jobs_number ; ++i)
+        if(batch->jobs[i].grid != NULL)
+        {
+            solver->grid_size = batch->jobs[i].grid_size;
+            grid_free(solver, batch->jobs[i].grid);
         }
-    }
 
+    pthread_cond_destroy(&batch->done);
+    pthread_mutex_destroy(&batch->lock);
+
+    free(batch->jobs);
+    free(batch->chunks);
+    free(batch->solvers);
 }
 
-#ifdef DEBUG
-static bool
-subgrid_print(pset_t* subgrid[])
+static void
+job_run(void* arg, int worker)
 {
-    char string[MAX_COLORS];
+    job_t* job = arg;
+    solver_t* solver = &job->batch->solvers[worker];
+    FILE* output_stream = solver->output_stream;
 
-    printf("subgrid:  ");
-    for(int i = 0 ; i < grid_size ; ++i)
+    solver->grid_size = job->grid_size;
+
+    // The verbose output is kept until the grid is printed
+    if(solver->verbose)
     {
-        pset2str(string, *subgrid[i]);
-        printf("(%d) = '%s'", i, string);
+        solver->output_stream = open_memstream(&job->trace, &job->trace_size);
+        if(solver->output_stream == NULL)
+            grid_error("out of memory !");
+    }
 
-        if(i < (grid_size - 1))
-            printf(", ");
+    job->solutions = grid_solver(solver, job->grid);
+
+    if(solver->verbose)
+    {
+        fclose(solver->output_stream);
+        solver->output_stream = output_stream;
     }
-    printf("\n");
 
-    return true;
+    pthread_mutex_lock(&job->batch->lock);
+    job->done = true;
+    pthread_cond_broadcast(&job->batch->done);
+    pthread_mutex_unlock(&job->batch->lock);
 }
-#endif
 
-static int 
-grid_solver(pset_t** grid)
+static bool
+grid_parser(solver_t* solver, reader_t* reader, pset_t** grid)
 {
-    // Current number of solutions
-    int result = 0;
-
-    if(!grid_consistency(grid))
-        return 0;
+    pset_t* result = *grid;
+    char* text;
+    size_t length;
+    // The first line can hold a whole grid (up to 64x64 cells)
+    char first_line[MAX_COLORS * MAX_COLORS];
+    // Row of the grid being scanned
+    int row = 0;
+    bool state_first_line = true;
+    // The first line holds the notations of an empty cell of one line grids
+    bool one_line_blanks = false;
 
-    int heuristics_result = grid_heuristics(grid);
+    // Scanning the grid, line by line
+    while((text = reader_line(reader, &length)) != NULL)
+    {
+        int column = 0;
 
-    // If heuristics resolve the grid, the grid has a unique solution
-    if(heuristics_result == SOLVED)
-        return 1;
+        for(size_t i = 0 ; i < length ; ++i)
+        {
+            char c = text[i];
+            int char_class = char_classes[(unsigned char) c];
 
-    if(heuristics_result == UNCONSISTENT)
-        return 0;
+            // Filter out blank characters
+            if(char_class == CHAR_BLANK)
+                continue;
 
-    // Choose a cell in the grid to apply the backtracking
-    int coordinates = grid_choice(grid);
-    int x, y;
+            // The commentary goes up to the end of the line
+            if(char_class == CHAR_COMMENT)
+                break;
 
-    // Compute coordinates
-    x = coordinates / grid_size;
-    y = coordinates % grid_size;
+            if(state_first_line)
+            {
+                if(column >= (int)sizeof(first_line))
+                    grid_error_line(reader->line);
+
+                // On the first line, the content is copied
+                // without checking the validity of the character
+                // as can't tell the size of the grid yet.
+                // Verifications are done when copying into the grid
+                first_line[column] = c;
+                if((c == '.') || (c == '0'))
+                    one_line_blanks = true;
+            }
+            else
+            {
+                if(column >= solver->grid_size)
+                    grid_error_line(reader->line);
 
-    int pset_card = pset_cardinality(grid[x][y]);
+                int cell = row * solver->grid_size + column;
 
-    pset_t** grid_tmp;
-    pset_t** grid_solution;
-    pset_t pset_left, pset_choosen;
+                if(check_input_char(solver, c))
+                    if(c == '_')
+                        result[cell] = pset_full(solver->grid_size);
+                    else
+                        result[cell] = char2pset(c);
+                else
+                    grid_error_char(c, reader->line);
+            }
 
-    grid_solution = NULL;
-    // Test the value of the cell for each color of the set
-    pset_choosen = grid[x][y];
-    // Random number of the color that will be choosen for the cell
-    for(int i = 0 ; i < pset_card ; ++i)
-    {
-        grid_tmp = grid_copy(grid);
-        // The generate mode relies on the fact that the choices
-        // are made randomly
-        // Else, a determinist choice is done
-        if(generate)
-        {
-            // Choose a random color in the choosen pset
-            int random_color = (rand() % pset_cardinality(pset_choosen)) + 1;
-            pset_left = pset_n_leftmost(pset_choosen, random_color);
-        }
-        else
-        {
-            pset_left = pset_leftmost(pset_choosen);
+            ++column;
         }
 
-        grid_tmp[x][y] = pset_left;
+        // Empty lines are ignored
+        if(column == 0)
+            continue;
 
-        if(verbose)
+        // Special process for the first line
+        if(state_first_line)
         {
-            char str_pset[MAX_COLORS + 1];
-            char str_left[MAX_COLORS + 1];
+            int size = (int)sqrt(column);
+            bool square = (size * size == column) && grid_valid_size(size);
+            bool one_line = false;
 
-            pset2str(str_pset, grid[x][y]);
-            pset2str(str_left, pset_left);
+            // A line which is not a row of a valid size can still
+            // be a whole grid written on one line
+            if(!grid_valid_size(column) || (square && one_line_blanks))
+            {
+                if(!square)
+                    grid_error_line(reader->line);
 
-            fprintf(output_stream,
-                    "Next choice at grid[%d][%d]"
-                    " = '%s' and choice is '%s'.\n",
-                    x,
-                    y,
-                    str_pset,
-                    str_left);
+                one_line = true;
+            }
+            else
+                size = column;
 
-            grid_print(grid_tmp);
-        }
+            // Reuse the grid of the previous call if possible
+            if((result == NULL) || (size != solver->grid_size))
+            {
+                if(result != NULL)
+                    grid_free(solver, result);
 
-        int number_of_solutions;
-        // Check if the new grid has at least one solution
-        if((number_of_solutions = grid_solver(grid_tmp)) >= 1)
-        {
-            result += number_of_solutions;
+                solver->grid_size = size;
+                result = grid_alloc(solver);
+                *grid = result;
+            }
 
-            // If strict mode is set and still not 2 solutions, then continue
-            if(strict && (result <= 1))
+            for(int i = 0 ; i < column ; ++i)
             {
-                // Store a solution if it has never be done 
-                if(grid_solution == NULL)
-                    grid_solution = grid_tmp;
+                // Index of the cell in the grid
+                int cell = one_line ? i : (row * solver->grid_size + i);
+                char c = first_line[i];
+
+                // Usual notations of an empty cell in one line grids
+                if(one_line && ((c == '.') || (c == '0')))
+                    c = '_';
+
+                // Check if it is valid content as it was not
+                // checked on the first copy
+                if(check_input_char(solver, c))
+                    if(c == '_')
+                        result[cell] = pset_full(solver->grid_size);
+                    else
+                        result[cell] = char2pset(c);
                 else
-                    grid_free(grid_tmp);
+                    grid_error_char(c, reader->line);
             }
-            else
-            {
-                if(grid_solution != NULL)
-                    grid_free(grid_solution);
 
-                // Copy the solution found to the grid
-                for(int j = 0 ; j < grid_size ; ++j)
-                {
-                    pset_t* tmp = grid[j];
-                    grid[j] = grid_tmp[j];
-                    grid_tmp[j] = tmp;
-                }
+            if(one_line)
+                return true;
 
-                grid_free(grid_tmp);
-                return result;
-            }
-        }
-        else
-        {
-            if(verbose)
-                fprintf(output_stream, "Bad choice.\n");
-            grid_free(grid_tmp);
+            state_first_line = false;
         }
 
-        // remove the choice for the color of the cell
-        pset_choosen = pset_substract(pset_choosen, pset_left);
-    }
+        if(column != solver->grid_size)
+            grid_error_line(reader->line);
 
-    // We are in this case if no solution were found
-    // Or if the strict mode is set and there is only one solution
-    if(grid_solution != NULL)
-    {
-        for(int i = 0 ; i < grid_size ; ++i)
-        {
-            pset_t* tmp = grid[i];
-            grid[i] = grid_solution[i];
-            grid_solution[i] = tmp;
-        }
-        grid_free(grid_solution);
+        ++row;
+
+        // The grid is complete, the next lines belong
+        // to the next grid of the stream
+        if(row == solver->grid_size)
+            return true;
     }
 
-    return result;
+    // The stream ended in the middle of a grid
+    if(!state_first_line)
+        grid_error_line_number();
+
+    return false;
 }
 
-static int
-grid_heuristics(pset_t** grid)
+static bool
+grid_parser_binary(solver_t* solver, reader_t* reader, pset_t** grid)
 {
-    bool fixpoint = false;
+    pset_t* result = *grid;
+    unsigned char* record;
+    int size;
+
+    record = reader_bytes(reader, 2);
+    if(record == NULL)
+        return false;
 
-    // Fixpoint is reached ?
-    while(!fixpoint)
+    // The status of the record does not matter, the grid is solved anyway
+    size = record[0];
+    if(!grid_valid_size(size))
+        grid_error("invalid size of a binary grid");
+
+    // Reuse the grid of the previous call if possible
+    if((result == NULL) || (size != solver->grid_size))
     {
-        // Apply heuristics to each subgrid
-        fixpoint = subgrid_map(grid, subgrid_heuristics);
+        if(result != NULL)
+            grid_free(solver, result);
 
-        if(verbose)
-        {
-            grid_print(grid);
-            fprintf(output_stream, "\n");
-        }
+        solver->grid_size = size;
+        result = grid_alloc(solver);
+        *grid = result;
     }
 
-    return grid_consistency(grid) ?
-        (grid_solved(grid) ? SOLVED : CONSISTENT): UNCONSISTENT;
-}
+    int bits = grid_cell_bits(size);
+    unsigned int mask = (1 << bits) - 1;
+    // Bits read and not unpacked yet
+    unsigned int pending = 0;
+    int pending_bits = 0;
 
-static bool
-subgrid_heuristics(pset_t* subgrid[])
-{
-    bool result = true;
+    record = reader_bytes(reader, grid_record_size(size) - 2);
+    if(record == NULL)
+        grid_error("truncated binary grid");
 
-    bool heuristic_result;
-    for(int i = 0 ; i < heuristics_number ; ++i)
+    for(int i = 0 ; i < grid_cells(solver) ; ++i)
     {
-        heuristic_result = heuristics[i](subgrid);
-        result = result & heuristic_result;
+        unsigned int value;
+
+        while(pending_bits < bits)
+        {
+            pending |= (unsigned int) *record++ << pending_bits;
+            pending_bits += 8;
+        }
+
+        value = pending & mask;
+        pending >>= bits;
+        pending_bits -= bits;
+
+        if(value == 0)
+            result[i] = pset_full(size);
+        else if((int) value <= size)
+            result[i] = ((pset_t) 1) << (value - 1);
+        else
+            grid_error("invalid cell in a binary grid");
     }
-    
-    return result;
+
+    return true;
 }
 
 static bool
-cross_hatching(pset_t* subgrid[])
+grid_read(solver_t* solver, reader_t* reader, pset_t** grid)
 {
-    bool result = true;
-    pset_t pset_tmp;
-
-    // Cross-hatching heuristic
-    pset_t pset_singletons = pset_empty();
-    for(int i = 0 ; i < grid_size ; ++i)
-        if(pset_is_singleton(*subgrid[i]))
-            pset_singletons = pset_or(pset_singletons, *subgrid[i]);
-
-    for(int i = 0 ; i < grid_size ; ++i)
-        if(!pset_is_singleton(*subgrid[i]))
-        {
-            pset_tmp = pset_substract(*subgrid[i], pset_singletons);
-            if(!pset_equals(pset_tmp, *subgrid[i]))
-            {
-                *subgrid[i] = pset_tmp;
-                result = false;
-            }
-        }
+    if(reader->binary)
+        return grid_parser_binary(solver, reader, grid);
 
-    return result;
+    return grid_parser(solver, reader, grid);
 }
 
-static bool
-lone_number(pset_t* subgrid[])
+static void
+reader_init(reader_t* reader, FILE* file)
 {
-    bool result = true;
-    pset_t pset_tmp;
+    struct stat file_stat;
+
+    reader->fd = fileno(file);
+    reader->start = 0;
+    reader->end_of_file = false;
+    reader->mapped = false;
+    reader->borrowed = false;
+    reader->binary = false;
+    reader->line = 0;
+
+    // The whole file is mapped at once, the empty files and the ones
+    // which cannot be mapped are read as the other streams
+    if((fstat(reader->fd, &file_stat) == 0) && S_ISREG(file_stat.st_mode)
+            && (file_stat.st_size > 0)
+            && ((uintmax_t)file_stat.st_size <= SIZE_MAX))
+    {
+        void* mapping = mmap(NULL,
+                file_stat.st_size,
+                PROT_READ,
+                MAP_PRIVATE,
+                reader->fd,
+                0);
+
+        if(mapping != MAP_FAILED)
+        {
+            posix_madvise(mapping, file_stat.st_size, POSIX_MADV_SEQUENTIAL);
 
-    // Lone-number heuristic
-    // Vector containing every color that appears only once in the subgrid
-    pset_t pset_lone = pset_empty();
-    // Vector containing every color that appears twice or more in the subgrid
-    pset_t pset_more = pset_empty();
+            reader->buffer = mapping;
+            reader->capacity = reader->end = file_stat.st_size;
+            reader->end_of_file = true;
+            reader->mapped = true;
+        }
+    }
 
-    for(int i = 0 ; i < grid_size ; ++i)
+    if(!reader->mapped)
     {
-        pset_t pset_lone_new, pset_more_new;
+        reader->capacity = 1 << 16;
+        reader->buffer = malloc(reader->capacity);
+        if(reader->buffer == NULL)
+            grid_error("out of memory !");
 
-        pset_lone_new = pset_xor(*subgrid[i], pset_lone);
-        pset_lone_new = pset_and(pset_lone_new, pset_negate(pset_more));
+        reader->end = 0;
 
-        pset_more_new = pset_and(*subgrid[i], pset_lone);
-        pset_more_new = pset_or(pset_more_new, pset_more);
+        while(!reader->end_of_file && (reader->end < BINARY_MAGIC_SIZE))
+            reader_fill(reader);
+    }
 
-        pset_lone = pset_lone_new;
-        pset_more = pset_more_new;
+    // A text grid cannot start with the magic number, as its first byte
+    // is neither a color nor a blank
+    if((reader->end >= BINARY_MAGIC_SIZE)
+            && (memcmp(reader->buffer, BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0))
+    {
+        reader->binary = true;
+        reader->start = BINARY_MAGIC_SIZE;
     }
+}
+
+static void
+reader_destroy(reader_t* reader)
+{
+    if(reader->mapped)
+        munmap(reader->buffer, reader->capacity);
+    else if(!reader->borrowed)
+        free(reader->buffer);
 
-    for(int i = 0 ; i < grid_size ; ++i)
+    reader->buffer = NULL;
+}
+
+static char*
+reader_line(reader_t* reader, size_t* length)
+{
+    char* result;
+    char* newline;
+    // Bytes already searched for the end of the line
+    size_t searched = 0;
+
+    while((newline = memchr(reader->buffer + reader->start + searched,
+                    '\n',
+                    reader->end - reader->start - searched)) == NULL)
     {
-        if(!pset_is_singleton(*subgrid[i]))
+        searched = reader->end - reader->start;
+
+        if(reader->end_of_file)
         {
-            pset_tmp = pset_and(*subgrid[i], pset_lone);
-            if(!pset_equals(pset_tmp, pset_empty())
-                    && !pset_equals(pset_tmp, *subgrid[i]))
-            {
-                *subgrid[i] = pset_tmp;
-                result = false;
-            }
+            if(searched == 0)
+                return NULL;
+
+            // The last line can be ended without a '\n'
+            result = reader->buffer + reader->start;
+            *length = searched;
+            reader->start = reader->end;
+            ++reader->line;
+
+            return result;
         }
+
+        reader_fill(reader);
     }
 
+    result = reader->buffer + reader->start;
+    *length = newline - result;
+    reader->start += *length + 1;
+    ++reader->line;
+
     return result;
 }
 
-static bool
-n_possible(pset_t* subgrid[])
+static unsigned char*
+reader_bytes(reader_t* reader, size_t size)
 {
-    bool result = true;
-    pset_t pset_tmp;
-
-    // N-possible heuristic
-    // When a n possible values are the only possible values on n cells
-    // of a subgrid, then those cells are the only place that can hold those
-    // values. So those n values can be removed from all other cells.
-    // (ref: http://sudokuassistant.co.uk/solving/solving-sudoku.htm)
-    for(int i = 0 ; i < grid_size ; ++i)
-        if(subgrid_count(subgrid, *subgrid[i])
-                == pset_cardinality(*subgrid[i]))
-            for(int j = 0 ; j < grid_size ; ++j)
-                // Working only on unsolved cells and cells that are not
-                // equal to the current pset
-                if((!pset_is_singleton(*subgrid[j]))
-                        && (!pset_equals(*subgrid[i], *subgrid[j])))
-                {
-                    pset_tmp = pset_substract(*subgrid[j], *subgrid[i]);
+    unsigned char* result;
 
-                    if(!pset_equals(pset_tmp, *subgrid[j]))
-                    {
-                        *subgrid[j] = pset_tmp;
-                        result = false;
-                    }
-                }
+    while((reader->end - reader->start) < size)
+    {
+        if(reader->end_of_file)
+        {
+            if(reader->end == reader->start)
+                return NULL;
+
+            grid_error("truncated binary grid");
+        }
+
+        reader_fill(reader);
+    }
+
+    result = (unsigned char*) reader->buffer + reader->start;
+    reader->start += size;
 
     return result;
 }
 
-static int 
-grid_choice(pset_t** grid)
+static void
+reader_fill(reader_t* reader)
 {
-    int result;
-    int x, y;
-    int current_cardinality, min_cardinality;
+    ssize_t bytes;
 
-    x = y = -1;
-    min_cardinality = MAX_COLORS + 1;
+    // Move the bytes not handed out yet at the beginning of the buffer
+    if(reader->start > 0)
+    {
+        memmove(reader->buffer,
+                reader->buffer + reader->start,
+                reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
 
-    for(int i = 0 ; i < grid_size ; ++i)
-        for(int j = 0 ; j < grid_size ; ++j)
-            if(pset_cardinality(grid[i][j]) > 1)
-            {
-                current_cardinality = pset_cardinality(grid[i][j]);
-                if(current_cardinality < min_cardinality)
-                {
-                    x = i;
-                    y = j;
-                    min_cardinality = current_cardinality;
-                }
-            }
+    // A line longer than the buffer
+    if(reader->end == reader->capacity)
+    {
+        reader->capacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->capacity);
+        if(reader->buffer == NULL)
+            grid_error("out of memory !");
+    }
 
-    if((x != -1) && (y != -1))
-        result = (x * grid_size) + y;
-    else
-        result = -1;
+    // Unlike fread(), read() returns what is available on a pipe or a
+    // terminal, so the grids are solved as they come
+    do
+        bytes = read(reader->fd,
+                reader->buffer + reader->end,
+                reader->capacity - reader->end);
+    while((bytes < 0) && (errno == EINTR));
 
-    return result;
-}
+    if(bytes < 0)
+        grid_error(strerror(errno));
 
-static bool
-grid_consistency(pset_t** grid)
-{
-    return subgrid_map(grid, subgrid_consistency);
+    if(bytes == 0)
+        reader->end_of_file = true;
+    else
+        reader->end += bytes;
 }
 
 static bool
-subgrid_consistency(pset_t* subgrid[])
+reader_chunk(reader_t* reader, reader_t* chunk, size_t size)
 {
-    bool result = true;
+    size_t cut;
 
-    // Check that each color appears at least once
-    pset_t pset_colors = pset_empty();
-    for(int i = 0 ; i < grid_size ; ++i)
-        pset_colors = pset_or(*subgrid[i], pset_colors);
-    result = result && pset_equals(pset_colors, pset_full(grid_size));
+    if(reader->start == reader->end)
+        return false;
 
-    // Check that there are not two singletons of the same color
-    pset_t pset_singletons = pset_empty();
-    for(int i = 0 ; (i < grid_size) && result ; ++i)
+    if(size >= reader->end - reader->start)
+        cut = reader->end;
+    else if(reader->binary)
     {
-        if(pset_is_singleton(*subgrid[i]))
+        // Skip whole records, the size of each one is its first byte
+        cut = reader->start;
+        while((cut < reader->end) && ((cut - reader->start) < size))
         {
-            if(pset_is_included(*subgrid[i], pset_singletons))
-                result = false;
+            int grid_size = (unsigned char) reader->buffer[cut];
+
+            // The parser reports the invalid record
+            if(!grid_valid_size(grid_size))
+                cut = reader->end;
             else
-                pset_singletons = pset_or(*subgrid[i], pset_singletons);
+                cut += grid_record_size(grid_size);
         }
+
+        if(cut > reader->end)
+            cut = reader->end;
     }
+    else
+    {
+        char* line = memchr(reader->buffer + reader->start + size,
+                '\n',
+                reader->end - reader->start - size);
+
+        // Look for a grid written on one line, from the line which
+        // follows the given size
+        cut = reader->end;
+        while(line != NULL)
+        {
+            size_t line_start = line + 1 - reader->buffer;
+            char* newline = memchr(reader->buffer + line_start,
+                    '\n',
+                    reader->end - line_start);
+            size_t line_end = (newline != NULL) ?
+                (size_t)(newline - reader->buffer) : reader->end;
+
+            if(line_is_grid(reader->buffer + line_start,
+                        line_end - line_start))
+            {
+                cut = (newline != NULL) ? (line_end + 1) : line_end;
+                break;
+            }
 
-    // Check that there is no empty cell
-    for(int i = 0 ; (i < grid_size) && result ; ++i)
-        result = result && !pset_equals(*subgrid[i], pset_empty());
+            line = newline;
+        }
+    }
 
-    return result;
-}
+    // The chunk reads its part of the mapping, in place
+    chunk->fd = -1;
+    chunk->buffer = reader->buffer + reader->start;
+    chunk->capacity = chunk->end = cut - reader->start;
+    chunk->start = 0;
+    chunk->end_of_file = true;
+    chunk->mapped = false;
+    chunk->borrowed = true;
+    chunk->binary = reader->binary;
+    chunk->line = reader->line;
+
+    // The lines of the chunk are counted, so the next one carries on
+    // the line numbers of the file
+    if(!reader->binary)
+    {
+        char* end = reader->buffer + cut;
+        char* newline = reader->buffer + reader->start;
 
-static int
-subgrid_count(pset_t* subgrid[], pset_t pset)
-{
-    int result = 0;
+        while((newline = memchr(newline, '\n', end - newline)) != NULL)
+        {
+            ++reader->line;
+            ++newline;
+        }
+    }
 
-    for(int i = 0 ; i < grid_size ; ++i)
-        if(pset_equals(*subgrid[i], pset))
-            ++result;
+    reader->start = cut;
 
-    return result;
+    return true;
 }
 
 static bool
-grid_solved(pset_t** grid)
+line_is_grid(const char* line, size_t length)
 {
-    bool result = true;
+    int cells = 0;
+    int size;
+    bool one_line_blanks = false;
 
-    for(int i = 0 ; (i < grid_size) && result ; ++i)
-        for(int j = 0 ; (j < grid_size) && result; ++j)
-            result = result && pset_is_singleton(grid[i][j]);
+    for(size_t i = 0 ; i < length ; ++i)
+    {
+        int char_class = char_classes[(unsigned char) line[i]];
 
-    return result;
-}
+        if(char_class == CHAR_COMMENT)
+            break;
+
+        if(char_class == CHAR_CELL)
+        {
+            ++cells;
+            if((line[i] == '.') || (line[i] == '0'))
+                one_line_blanks = true;
+        }
+    }
+
+    // As in grid_parser(), a line which is a row of a valid size is a row,
+    // unless it holds the notations of an empty cell of one line grids
+    size = (int)sqrt(cells);
 
+    return (!grid_valid_size(cells) || one_line_blanks)
+        && (size * size == cells) && grid_valid_size(size);
+}
 
 static bool
-grid_valid_size(int size)
+check_input_char(solver_t* solver, char c)
 {
-    bool result = false;
-    // Valid sizes for the grids
-    unsigned short valid_size_number = 8;
-    unsigned short valid_sizes[] = {1, 4, 9, 16, 25, 36, 49, 64};
-
-    for(int i = 0 ; (i < valid_size_number) && !result ; ++i)
-        if(size == valid_sizes[i])
-            result = true;
+    pset_t pset = char2pset(c);
 
-    return result;
+    // The color has to be one of the grid_size first ones
+    return (c == '_') || (!pset_equals(pset, pset_empty())
+            && pset_is_included(pset, pset_full(solver->grid_size)));
 }
 
-static void
+void
 grid_error(const char* error_message)
 {
+    chunk_t* chunk = pthread_getspecific(chunk_key);
+
+    // The error is reported by the main thread, once the grids of the
+    // chunk which precede it have been printed
+    if(chunk != NULL)
+    {
+        snprintf(chunk->error, sizeof(chunk->error), "%s", error_message);
+        longjmp(chunk->error_jump, 1);
+    }
+
+    if((error_batch != NULL) && pthread_equal(pthread_self(), main_thread))
+    {
+        batch_t* batch = error_batch;
+
+        // An error while printing the batch does not print it again
+        error_batch = NULL;
+        batch_flush(batch, error_solver);
+    }
+
     fprintf(stderr, "%s: error: ", soft_name);
+    if(input_name != NULL)
+        fprintf(stderr, "%s: ", input_name);
     fprintf(stderr, "%s\n", error_message);
 
     exit(EXIT_FAILURE);
@@ -1043,6 +1451,34 @@ grid_error_char(char character, int line)
     grid_error(error_message);
 }
 
+static void
+stats_print(solver_stats_t* stats, struct timespec* start)
+{
+    struct timespec end;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Only the buffers of the solvers are counted, not the ones of the
+    // pool nor the streams which keep the output of the workers
+    fprintf(stderr,
+            "%s: %lu grids, %lu nodes, %lu solver allocations, %.3f s\n",
+            soft_name,
+            stats->grids,
+            stats->nodes,
+            stats->allocations,
+            (end.tv_sec - start->tv_sec)
+            + (end.tv_nsec - start->tv_nsec) / 1e9);
+
+    for(int i = 0 ; i < HEURISTICS_NUMBER ; ++i)
+        if(stats->heuristics[i].calls > 0)
+            fprintf(stderr, "%s: %s: %lu calls, %lu colors removed, %.3f s\n",
+                    soft_name,
+                    heuristic_name(i),
+                    stats->heuristics[i].calls,
+                    stats->heuristics[i].removed,
+                    stats->heuristics[i].time);
+}
+
 static void
 usage(int status)
 {
@@ -1050,7 +1486,9 @@ usage(int status)
     {
         case EXIT_SUCCESS: // Print the usage of the software
             printf("Usage: %s [OPTION] FILE...\n", soft_name);
-            printf("Solve Sudoku puzzle's of variable sizes (1-4).\n\n"
+            printf("Solve Sudoku puzzle's of variable sizes (1-4).\n"
+                    "Every grid of every FILE is solved, in order. "
+                    "With FILE -, read standard input.\n\n"
                     "\t-o, --output=FILE\twrite result to FILE\n"
                     "\t-v, --verbose\t\tverbose output\n"
                     "\t-V, --version\t\tdisplay version and exit\n"
@@ -1058,7 +1496,27 @@ usage(int status)
                     "\t-g [size], --generate=[size]\t\t"
                     "generate a grid of length size (default : 9)\n"
                     "\t-s, --strict\t\tenforce the generation of a grid"
-                    "with only one solution\n");
+                    "with only one solution\n"
+                    "\t-j N, --jobs=N\t\tsolve N grids at the same time "
+                    "(default : number of processors)\n"
+                    "\t-p [depth], --parallel=[depth]\t"
+                    "solve the branches of the depth first levels of the "
+                    "search of each grid in parallel (default : 3)\n"
+                    "\t-S, --stats\t\tprint the number of grids, nodes "
+                    "and allocations of the buffers of the solvers, and the "
+                    "time spent\n"
+                    "\t-c, --compact\t\tprint each grid on one line, "
+                    "'.' standing for the cells not solved\n"
+                    "\t-b, --binary\t\twrite the grids in the binary "
+                    "format, which is also read from any FILE\n"
+                    "\t-x, --dlx\t\tsolve the grids as exact cover "
+                    "problems, with the dancing links\n"
+                    "\t-H LIST, --heuristics=LIST\tapply the heuristics "
+                    "of LIST to the subgrids, in order, separated by ',', "
+                    "the ones before a '/' until they deduce nothing more "
+                    "before the others (heuristics : cross_hatching, "
+                    "lone_number, n_possible, intersections, hidden_subsets, "
+                    "x_wing ; LIST must hold cross_hatching)\n");
             break;
         default: // Explain how to get help
             fprintf(stderr,
@@ -10,8 +10,29 @@
 #define PROG_SUBVERSION 0
 #define PROG_REVISION   0
 
+// Maximum number of grids solved at the same time
+#define MAX_JOBS 1024
+
+// Largest size of the parts of a mapped file given to the workers
+#define CHUNK_SIZE (1 << 20)
+
 #define SOLVED 0
 #define CONSISTENT 1
 #define UNCONSISTENT 2
 
+// Binary format of the grids
+// A stream starts with the magic number, followed by a record per grid:
+// its size on a byte, its status on a byte (CONSISTENT for a grid to solve,
+// SOLVED or UNCONSISTENT for a grid solved or without solution) then its
+// cells row after row, packed on grid_cell_bits() bits each, from the
+// lowest bit of each byte. A cell holds 0 if it is not solved, or the
+// index of its color plus one.
+// The magic number starts with the byte 0xFF, which no text line holds.
+#define BINARY_MAGIC "\377SKB"
+#define BINARY_MAGIC_SIZE 4
+
+// Print the grids solved so far, write the string on the error stream
+// then exit
+void grid_error(const char*);
+
 #endif
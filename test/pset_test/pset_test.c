@@ -568,5 +568,69 @@ main (void)
 	  pset_cardinality (p4));
   display_result ((pset_cardinality (p4) == 37));
 
+  p4 = pset_full (64);
+  printf ("pset_cardinality (full 64): %d ", pset_cardinality (p4));
+  display_result ((pset_cardinality (p4) == 64));
+
+  fputs ("\n", stdout);
+
+
+  /* Testing pset_leftmost */
+  /*************************/
+  fputs ("pset_leftmost\n" "=============\n", stdout);
+
+  p4 = pset_set (pset_set (char2pset ('C'), '7'), '3');
+  pset2str (str2, pset_leftmost (p4));
+  printf ("pset_leftmost (\"37C\"): \"%s\" ", str2);
+  display_result (pset_equals (pset_leftmost (p4), char2pset ('3')));
+
+  pset2str (str2, pset_leftmost (pset_empty ()));
+  printf ("pset_leftmost (\"\"): \"%s\" ", str2);
+  display_result (pset_equals (pset_leftmost (pset_empty ()), pset_empty ()));
+
+  fputs ("\n", stdout);
+
+
+  /* Testing pset_index */
+  /**********************/
+  fputs ("pset_index\n" "==========\n", stdout);
+
+  printf ("pset_index (\"37C\"): %d ", pset_index (p4));
+  display_result (pset_index (p4) == 2);
+
+  printf ("pset_index (\"1\"): %d ", pset_index (char2pset ('1')));
+  display_result (pset_index (char2pset ('1')) == 0);
+
+  printf ("pset_index (\"*\"): %d ", pset_index (char2pset ('*')));
+  display_result (pset_index (char2pset ('*')) == 63);
+
+  fputs ("\n", stdout);
+
+
+  /* Testing pset_n_leftmost */
+  /***************************/
+  fputs ("pset_n_leftmost\n" "===============\n", stdout);
+
+  pset2str (str2, pset_n_leftmost (p4, 2));
+  printf ("pset_n_leftmost (\"37C\", 2): \"%s\" ", str2);
+  display_result (pset_equals (pset_n_leftmost (p4, 2), char2pset ('7')));
+
+  pset2str (str2, pset_n_leftmost (p4, 3));
+  printf ("pset_n_leftmost (\"37C\", 3): \"%s\" ", str2);
+  display_result (pset_equals (pset_n_leftmost (p4, 3), char2pset ('C')));
+
+  pset2str (str2, pset_n_leftmost (p4, 4));
+  printf ("pset_n_leftmost (\"37C\", 4): \"%s\" ", str2);
+  display_result (pset_equals (pset_n_leftmost (p4, 4), pset_empty ()));
+
+  pset2str (str2, pset_n_leftmost (p4, 0));
+  printf ("pset_n_leftmost (\"37C\", 0): \"%s\" ", str2);
+  display_result (pset_equals (pset_n_leftmost (p4, 0), p4));
+
+  p4 = pset_full (64);
+  pset2str (str2, pset_n_leftmost (p4, 64));
+  printf ("pset_n_leftmost (full 64, 64): \"%s\" ", str2);
+  display_result (pset_equals (pset_n_leftmost (p4, 64), char2pset ('*')));
+
   return EXIT_SUCCESS;
 }